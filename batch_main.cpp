@@ -0,0 +1,435 @@
+// Headless batch converter: runs loadImage -> processImage -> generateCode over whole directories without a display
+
+#include "processing.h"
+#include "block_kernel.h"
+#include "coord_serializer.h"
+#include "thread_pool.h"
+#include "video_pipeline.h"
+#include "tiled_processing.h"
+#include "parameter_sweep.h"
+#include "result_cache.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+
+namespace fs = std::filesystem;
+
+struct BatchOptions {
+    std::string input;          // Directory, single file, or glob like "frames/*.png"
+    fs::path inputRoot;         // Directory the inputs were collected from; outputs mirror their paths below it
+    std::string outputDir = "out";
+    ProcessingParams params;
+    std::string format = "csharp";
+    unsigned threads = 0;       // 0 = one per hardware thread
+    bool writePreview = true;
+    bool recursive = false;
+    // Streaming mode (--video)
+    std::string video;
+    std::string videoOut;
+    std::string fourcc = "mp4v";
+    size_t queueDepth = 8;
+    bool writeCoords = true;
+    // Tiled mode (--tile)
+    int tileSize = 0;
+    int cannyHalo = 32;
+    // Result cache (--cache)
+    std::string cacheDir;
+    std::uint64_t cacheMegabytes = 256;
+    // Sweep mode (--sweep-*)
+    SweepSpec sweep;
+    bool sweepEnabled = false;
+};
+
+// --- Function Prototypes ---
+static void printUsage(const char* exe);
+static bool parseArgs(int argc, char** argv, BatchOptions& opts);
+static bool wildcardMatch(const char* pattern, const char* name);
+static bool isImageFile(const fs::path& path);
+static std::vector<fs::path> collectInputs(const std::string& input, bool recursive, fs::path& outRoot);
+static fs::path outputBase(const fs::path& inputPath, const BatchOptions& opts);
+static bool prepareOutputPaths(const std::vector<fs::path>& inputs, const BatchOptions& opts);
+static bool processFile(const fs::path& inputPath, const BatchOptions& opts, ProcessingCache& cache, ResultCache& results);
+static bool processFileTiled(const fs::path& inputPath, const BatchOptions& opts);
+static int runSweep(const std::vector<fs::path>& inputs, const BatchOptions& opts);
+
+
+int main(int argc, char** argv) {
+    BatchOptions opts;
+    if (!parseArgs(argc, argv, opts)) { printUsage(argv[0]); return 1; }
+
+    if (!opts.video.empty()) {
+        VideoJob job;
+        job.input = opts.video; job.outputDir = opts.outputDir; job.outputVideo = opts.videoOut;
+        job.params = opts.params; job.format = opts.format; job.fourcc = opts.fourcc;
+        job.workers = opts.threads; job.queueDepth = opts.queueDepth; job.writeCoords = opts.writeCoords;
+        return runVideoPipeline(job) ? 0 : 2;
+    }
+
+    std::vector<fs::path> inputs = collectInputs(opts.input, opts.recursive, opts.inputRoot);
+    if (inputs.empty()) { std::cerr << "No input images found for: " << opts.input << std::endl; return 1; }
+
+    std::error_code ec;
+    fs::create_directories(opts.outputDir, ec);
+    if (ec) { std::cerr << "Failed to create output directory " << opts.outputDir << ": " << ec.message() << std::endl; return 1; }
+    if (!prepareOutputPaths(inputs, opts)) return 1;
+
+    // Sweep mode: one image at a time, the parallelism goes into the parameter grid
+    if (opts.sweepEnabled) return runSweep(inputs, opts);
+
+    // Tiled mode: one image at a time, the parallelism goes into its tiles instead
+    if (opts.tileSize > 0) {
+        size_t failed = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const fs::path& path : inputs) { if (!processFileTiled(path, opts)) failed++; }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Processed " << inputs.size() - failed << " image(s), " << failed << " failed, in "
+                  << seconds << " s (" << (seconds > 0.0 ? inputs.size() / seconds : 0.0) << " images/sec)" << std::endl;
+        return failed == 0 ? 0 : 2;
+    }
+
+    ThreadPool pool(opts.threads);
+    // Parallelism comes from the pool; letting OpenCV spawn its own threads on top only oversubscribes the cores
+    if (pool.size() > 1) cv::setNumThreads(1);
+
+    std::cout << "Processing " << inputs.size() << " image(s) on " << pool.size() << " worker(s)..." << std::endl;
+
+    // One cache per worker, so consecutive images on a thread recycle the same stage buffers
+    std::vector<ProcessingCache> caches(pool.size());
+    ResultCache results(opts.cacheDir, opts.cacheMegabytes << 20);
+    std::atomic<size_t> done{ 0 }, failed{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+    for (const fs::path& path : inputs) {
+        pool.submit([&, path] {
+            if (!processFile(path, opts, caches[pool.currentWorkerIndex()], results)) failed++;
+            size_t finished = ++done;
+            if (finished % 100 == 0) std::cout << "  " << finished << " / " << inputs.size() << std::endl;
+        });
+    }
+    pool.wait();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Processed " << done.load() - failed.load() << " image(s), " << failed.load() << " failed, in "
+              << seconds << " s (" << (seconds > 0.0 ? done.load() / seconds : 0.0) << " images/sec)" << std::endl;
+    size_t reuses = 0, allocations = 0, peakBytes = 0;
+    for (const ProcessingCache& cache : caches) {
+        reuses += cache.workspace().reuses();
+        allocations += cache.workspace().allocations();
+        peakBytes += cache.workspace().peakBytes();
+    }
+    std::cout << "Stage buffers: " << reuses << " reused, " << allocations << " allocated, "
+              << peakBytes / (1024.0 * 1024.0) << " MB peak over all workers" << std::endl;
+    if (results.enabled()) {
+        std::cout << "Result cache: " << results.hits() << " hit(s), " << results.misses() << " miss(es), "
+                  << std::fixed << std::setprecision(1) << results.hitRate() * 100.0 << "% hit rate, " << results.evictions() << " evicted" << std::endl;
+    }
+    return failed.load() == 0 ? 0 : 2;
+}
+
+
+static void printUsage(const char* exe) {
+    std::cerr << "Usage: " << exe << " <input-dir|file|glob> [options]\n"
+                 "       " << exe << " --video <clip|frame-pattern> [options]\n"
+                 "  -o, --output <dir>     Output directory (default: out)\n"
+                 "  -j, --threads <n>      Worker count (default: hardware threads)\n"
+                 "  --preset <file>        Load ProcessingParams from a 'key = value' preset file\n"
+                 "  --set <key>=<value>    Override a single parameter (scale, pixelSize, brightness, contrast,\n"
+                 "                         applyBlur, blurKernel, cannyLow, cannyHigh, flipV, flipH)\n"
+                 "  --format <id>          csharp | js | python | packed | spans | bitset (default: csharp)\n"
+                 "  --no-preview           Don't write the pixel-art preview PNGs\n"
+                 "  -r, --recursive        Recurse into subdirectories\n"
+                 "  --tile <size>          Process each image in tiles of this size (bounded memory for huge inputs)\n"
+                 "  --canny-halo <px>      Context around each tile for edge continuity (default: 32)\n"
+                 "  --cache <dir>          Reuse results from earlier runs stored in <dir> (keyed by file content + params);\n"
+                 "                         hits skip decoding and processing. Shareable between concurrent runs; not used by --tile/--sweep-*.\n"
+                 "  --cache-size <MB>      Size limit of the cache directory, least recently used entries go first (default: 256)\n"
+                 "Sweep mode (any --sweep-* option; values as first:last:step or a,b,c):\n"
+                 "  --sweep-low <values>   cannyLow values\n"
+                 "  --sweep-high <values>  cannyHigh values\n"
+                 "  --sweep-pixel <values> pixelSize values\n"
+                 "  --sweep-blur <values>  blurKernel values (0 = no blur)\n"
+                 "                         Writes <name>_sweep.png contact sheets and sweep.csv (block counts, timings)\n"
+                 "Streaming mode:\n"
+                 "  --video <input>        Video file or numbered sequence (e.g. frames/img_%04d.png)\n"
+                 "  --video-out <file>     Output video (default: <output>/<name>_pixels.mp4)\n"
+                 "  --fourcc <code>        Output codec FourCC (default: mp4v)\n"
+                 "  --queue-depth <n>      Frames buffered between pipeline stages (default: 8)\n"
+                 "  --no-coords            Don't write per-frame coordinate files\n";
+}
+
+static bool parseArgs(int argc, char** argv, BatchOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](std::string& out) {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << arg << std::endl; return false; }
+            out = argv[++i]; return true;
+        };
+        std::string value;
+        if (arg == "-o" || arg == "--output") { if (!next(opts.outputDir)) return false; }
+        else if (arg == "-j" || arg == "--threads") {
+            if (!next(value)) return false;
+            try { opts.threads = static_cast<unsigned>(std::max(0, std::stoi(value))); }
+            catch (const std::exception&) { std::cerr << "Invalid thread count: " << value << std::endl; return false; }
+        }
+        else if (arg == "--preset") { if (!next(value) || !loadPreset(value, opts.params)) return false; }
+        else if (arg == "--set") {
+            if (!next(value)) return false;
+            size_t eq = value.find('=');
+            if (eq == std::string::npos || !setProcessingParam(opts.params, value.substr(0, eq), value.substr(eq + 1))) {
+                std::cerr << "Invalid parameter override: " << value << std::endl; return false;
+            }
+        }
+        else if (arg == "--format") {
+            if (!next(opts.format)) return false;
+            CoordFormat coordFormat;
+            if (!parseCoordFormat(opts.format, coordFormat)) { std::cerr << "Unknown format: " << opts.format << std::endl; return false; }
+        }
+        else if (arg == "--no-preview") { opts.writePreview = false; }
+        else if (arg == "--video") { if (!next(opts.video)) return false; }
+        else if (arg == "--video-out") { if (!next(opts.videoOut)) return false; }
+        else if (arg == "--fourcc") { if (!next(opts.fourcc)) return false; }
+        else if (arg == "--queue-depth") {
+            if (!next(value)) return false;
+            try { opts.queueDepth = static_cast<size_t>(std::max(1, std::stoi(value))); }
+            catch (const std::exception&) { std::cerr << "Invalid queue depth: " << value << std::endl; return false; }
+        }
+        else if (arg == "--no-coords") { opts.writeCoords = false; }
+        else if (arg == "--cache") { if (!next(opts.cacheDir)) return false; }
+        else if (arg == "--cache-size") {
+            if (!next(value)) return false;
+            try { opts.cacheMegabytes = static_cast<std::uint64_t>(std::max(1, std::stoi(value))); }
+            catch (const std::exception&) { std::cerr << "Invalid cache size: " << value << std::endl; return false; }
+        }
+        else if (arg == "--tile" || arg == "--canny-halo") {
+            if (!next(value)) return false;
+            try { (arg == "--tile" ? opts.tileSize : opts.cannyHalo) = std::max(0, std::stoi(value)); }
+            catch (const std::exception&) { std::cerr << "Invalid value for " << arg << ": " << value << std::endl; return false; }
+        }
+        else if (arg == "--sweep-low" || arg == "--sweep-high" || arg == "--sweep-pixel" || arg == "--sweep-blur") {
+            if (!next(value)) return false;
+            std::vector<int>& values = arg == "--sweep-low" ? opts.sweep.cannyLow : arg == "--sweep-high" ? opts.sweep.cannyHigh
+                                     : arg == "--sweep-pixel" ? opts.sweep.pixelSize : opts.sweep.blurKernel;
+            if (!parseSweepValues(value, values)) { std::cerr << "Invalid values for " << arg << ": " << value << std::endl; return false; }
+            opts.sweepEnabled = true;
+        }
+        else if (arg == "-r" || arg == "--recursive") { opts.recursive = true; }
+        else if (arg == "-h" || arg == "--help") { return false; }
+        else if (!arg.empty() && arg[0] == '-') { std::cerr << "Unknown option: " << arg << std::endl; return false; }
+        else if (opts.input.empty()) { opts.input = arg; }
+        else { std::cerr << "Unexpected argument: " << arg << std::endl; return false; }
+    }
+    return !opts.input.empty() || !opts.video.empty();
+}
+
+// Matches '*' and '?' wildcards against a file name
+static bool wildcardMatch(const char* pattern, const char* name) {
+    const char* starPattern = nullptr; const char* starName = nullptr;
+    while (*name) {
+        if (*pattern == '?' || *pattern == *name) { ++pattern; ++name; }
+        else if (*pattern == '*') { starPattern = pattern++; starName = name; }
+        else if (starPattern) { pattern = starPattern + 1; name = ++starName; }
+        else return false;
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == '\0';
+}
+
+static bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tif" || ext == ".tiff";
+}
+
+static std::vector<fs::path> collectInputs(const std::string& input, bool recursive, fs::path& outRoot) {
+    std::vector<fs::path> result;
+    fs::path inputPath(input);
+    std::error_code ec;
+
+    std::string pattern;
+    fs::path dir;
+    if (input.find_first_of("*?") != std::string::npos) {
+        pattern = inputPath.filename().string();
+        dir = inputPath.has_parent_path() ? inputPath.parent_path() : fs::path(".");
+    }
+    else if (fs::is_directory(inputPath, ec)) { dir = inputPath; }
+    else if (fs::is_regular_file(inputPath, ec)) {
+        outRoot = inputPath.has_parent_path() ? inputPath.parent_path() : fs::path(".");
+        result.push_back(inputPath); return result;
+    }
+    else { return result; }
+    outRoot = dir;
+
+    auto consider = [&](const fs::directory_entry& entry) {
+        if (!entry.is_regular_file(ec)) return;
+        const fs::path& path = entry.path();
+        if (pattern.empty() ? isImageFile(path) : wildcardMatch(pattern.c_str(), path.filename().string().c_str())) result.push_back(path);
+    };
+    if (recursive) { for (const auto& entry : fs::recursive_directory_iterator(dir, ec)) consider(entry); }
+    else { for (const auto& entry : fs::directory_iterator(dir, ec)) consider(entry); }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Output path without extension for an input: its path below the input root, under the output directory. Inputs outside
+// the root (not possible with collectInputs) fall back to their file name.
+static fs::path outputBase(const fs::path& inputPath, const BatchOptions& opts) {
+    fs::path relative = inputPath.lexically_relative(opts.inputRoot);
+    if (relative.empty() || *relative.begin() == "..") relative = inputPath.filename();
+    return fs::path(opts.outputDir) / relative.parent_path() / relative.stem();
+}
+
+// Creates the mirrored subdirectories up front, and refuses to start if two inputs would write the same outputs
+// ("a.png" and "a.jpg"), since the workers would silently overwrite each other's files
+static bool prepareOutputPaths(const std::vector<fs::path>& inputs, const BatchOptions& opts) {
+    std::map<std::string, fs::path> seen;
+    bool ok = true;
+    for (const fs::path& path : inputs) {
+        const fs::path base = outputBase(path, opts);
+        std::string key = base.lexically_normal().generic_string();
+#if defined(_WIN32)
+        // Windows file names are case-insensitive
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+        const auto inserted = seen.emplace(key, path);
+        if (!inserted.second) {
+            std::cerr << "Inputs " << inserted.first->second.string() << " and " << path.string() << " would both write "
+                      << base.string() << ".*; rename one of them" << std::endl;
+            ok = false;
+            continue;
+        }
+        std::error_code ec;
+        fs::create_directories(base.parent_path(), ec);
+        if (ec) { std::cerr << "Failed to create output directory " << base.parent_path().string() << ": " << ec.message() << std::endl; ok = false; }
+    }
+    return ok;
+}
+
+static bool processFile(const fs::path& inputPath, const BatchOptions& opts, ProcessingCache& cache, ResultCache& results) {
+    std::string key;
+    CachedResult cached;
+    const bool cacheable = results.enabled() && results.makeKey(inputPath.string(), opts.params, key);
+    cv::Mat pixelArtMat;
+    std::vector<sf::Vector2i> blockCoords;
+
+    if (cacheable && results.load(key, cached)) {
+        // Hit: no decode, no pipeline; the raster is only rebuilt if a preview is wanted
+        cached.blockGrid.appendCoords(blockCoords);
+        if (opts.writePreview) pixelArtFromGrid(cached.blockGrid, cached.processedSize, cached.pixelSize, pixelArtMat);
+    }
+    else {
+        cv::Mat originalMat = loadImageBgr(inputPath.string());
+        if (originalMat.empty()) { std::cerr << "Failed to load image: " << inputPath.string() << std::endl; return false; }
+
+        // Nothing carries over from the previous image except the buffers: releasing its stage outputs returns them to the pool
+        cache.invalidate();
+        processImage(originalMat, pixelArtMat, opts.params, blockCoords, cache);
+        if (pixelArtMat.empty()) { std::cerr << "Processing failed: " << inputPath.string() << std::endl; return false; }
+
+        cached.processedSize = pixelArtMat.size();
+        cached.pixelSize = std::max(2, opts.params.pixelSize);
+        cached.blockGrid = cache.blocks();
+        if (cacheable) results.store(key, cached);
+    }
+
+    const fs::path outBase = outputBase(inputPath, opts);
+    if (!writeCoordsFile(outBase.string() + "." + codeFileExtension(opts.format), blockCoords, opts.format, cached.blockGrid.size())) {
+        std::cerr << "Failed to write coordinates for: " << inputPath.string() << std::endl; return false;
+    }
+
+    if (opts.writePreview && !cv::imwrite(outBase.string() + "_pixels.png", pixelArtMat)) {
+        std::cerr << "Failed to write preview for: " << inputPath.string() << std::endl; return false;
+    }
+    return true;
+}
+
+static bool processFileTiled(const fs::path& inputPath, const BatchOptions& opts) {
+    TiledOptions tiledOptions;
+    tiledOptions.tileSize = opts.tileSize;
+    tiledOptions.cannyHalo = opts.cannyHalo;
+    tiledOptions.threads = opts.threads;
+
+    TiledResult result;
+    if (!processImageTiled(inputPath.string(), opts.params, tiledOptions, result)) return false;
+    std::cout << "  " << inputPath.filename().string() << ": " << result.processedSize.width << "x" << result.processedSize.height << ", "
+              << result.tileCount << " tile(s), " << result.blockCoords.size() << " block(s)" << (result.streamed ? ", streamed" : "") << std::endl;
+
+    const fs::path outBase = outputBase(inputPath, opts);
+    if (!writeCoordsFile(outBase.string() + "." + codeFileExtension(opts.format), result.blockCoords, opts.format, { result.blockMask.cols, result.blockMask.rows })) {
+        std::cerr << "Failed to write coordinates for: " << inputPath.string() << std::endl; return false;
+    }
+
+    // A full-resolution preview would be as large as the input; write one pixel per block instead
+    if (opts.writePreview && !cv::imwrite(outBase.string() + "_blocks.png", result.blockMask)) {
+        std::cerr << "Failed to write preview for: " << inputPath.string() << std::endl; return false;
+    }
+    return true;
+}
+
+// Evaluates the sweep grid on every input, writes a contact sheet per image and one CSV for the whole set,
+// then prints each combination's average over the set so a preset can be picked for all of them
+static int runSweep(const std::vector<fs::path>& inputs, const BatchOptions& opts) {
+    SweepSpec spec = opts.sweep;
+    spec.base = opts.params;
+    spec.threads = opts.threads;
+
+    const fs::path csvPath = fs::path(opts.outputDir) / "sweep.csv";
+    std::ofstream csv(csvPath);
+    if (!csv) { std::cerr << "Failed to write " << csvPath.string() << std::endl; return 1; }
+    csv << "image,cannyLow,cannyHigh,pixelSize,blurKernel,blocks,canny_ms,pixelate_ms\n";
+
+    std::vector<SweepResult> totals; // Summed over the images, in grid order
+    size_t failed = 0, succeeded = 0;
+    for (const fs::path& path : inputs) {
+        cv::Mat originalMat = loadImageBgr(path.string());
+        SweepReport report;
+        if (originalMat.empty() || !runParameterSweep(originalMat, spec, report)) {
+            std::cerr << "Sweep failed for: " << path.string() << std::endl; failed++; continue;
+        }
+        const std::string imageName = path.lexically_relative(opts.inputRoot).generic_string();
+        std::cout << "  " << imageName << ": " << report.results.size() << " combination(s), " << report.upstreamRuns
+                  << " upstream chain(s), " << report.cannyRuns << " Canny run(s) in " << report.totalMs << " ms" << std::endl;
+
+        for (const SweepResult& r : report.results) {
+            csv << imageName << "," << r.params.cannyLow << "," << r.params.cannyHigh << "," << r.params.pixelSize << ","
+                << (r.params.applyBlur ? r.params.blurKernel : 0) << "," << r.blockCount << "," << r.cannyMs << "," << r.pixelateMs << "\n";
+        }
+        if (totals.empty()) totals = report.results;
+        else {
+            for (size_t i = 0; i < totals.size() && i < report.results.size(); ++i) {
+                totals[i].blockCount += report.results[i].blockCount;
+                totals[i].cannyMs += report.results[i].cannyMs;
+                totals[i].pixelateMs += report.results[i].pixelateMs;
+            }
+        }
+        succeeded++;
+
+        if (opts.writePreview) {
+            const cv::Mat sheet = buildContactSheet(report.results, 240, 6);
+            const std::string sheetPath = outputBase(path, opts).string() + "_sweep.png";
+            if (!cv::imwrite(sheetPath, sheet)) { std::cerr << "Failed to write " << sheetPath << std::endl; failed++; }
+        }
+    }
+
+    if (succeeded > 0) {
+        std::cout << "Average over " << succeeded << " image(s):" << std::endl;
+        for (const SweepResult& r : totals) {
+            std::cout << "  " << std::left << std::setw(36) << sweepLabel(r.params) << std::right << std::setw(10) << r.blockCount / succeeded
+                      << " blocks " << std::fixed << std::setprecision(2) << std::setw(9) << (r.cannyMs + r.pixelateMs) / succeeded << " ms" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+    std::cout << "Wrote " << csvPath.string() << std::endl;
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,535 @@
+// Pipeline benchmark: per-stage timings over synthetic/real images and a golden-output regression check
+
+#include "processing.h"
+#include "block_kernel.h"
+#include "preprocess_kernel.h"
+#include "coord_serializer.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct BenchImage {
+    std::string id;     // "synthetic-4MP" or the file name
+    cv::Mat mat;
+};
+
+struct BenchPreset {
+    std::string name;
+    ProcessingParams params;
+};
+
+struct BenchOptions {
+    std::vector<double> megapixels = { 0.25, 1.0, 4.0, 16.0, 100.0 };
+    std::vector<std::string> images;
+    int repeat = 3;
+    std::string label = "current";
+    std::string csvPath;
+    std::string comparePath;
+    std::string goldenWritePath;
+    std::string goldenCheckPath;
+    bool checkKernel = false;
+    bool serializer = false;
+    bool timings = true;
+};
+
+// One CSV row: label,image,megapixels,preset,stage,min_ms,median_ms
+struct BenchRow {
+    std::string image, preset, stage;
+    double megapixels = 0.0, minMs = 0.0, medianMs = 0.0;
+};
+
+// Timed stages, in pipeline order, then the fused pass that replaces convertTo..grayscale in processImage
+static const char* stageNames[] = { "resize", "convertTo", "GaussianBlur", "flip", "grayscale", "Canny", "pixelation", "generateCode", "fused preproc" };
+static const int stageNameCount = sizeof(stageNames) / sizeof(stageNames[0]);
+static const int generateCodeRow = ProcessingCache::StagePixelate + 1, fusedRow = generateCodeRow + 1;
+
+// --- Function Prototypes ---
+static void printUsage(const char* exe);
+static bool parseArgs(int argc, char** argv, BenchOptions& opts);
+static cv::Mat makeSyntheticImage(double megapixels, std::uint64_t seed);
+static std::vector<BenchPreset> presetMatrix();
+static std::vector<BenchRow> timeImage(const BenchImage& image, const BenchPreset& preset, int repeat);
+static bool checkKernelAgainstReference();
+static bool checkPreprocessAgainstStages();
+static bool benchSerializer(int repeat);
+static std::map<std::string, std::string> goldenEntries(const std::vector<BenchImage>& images, const std::vector<BenchPreset>& presets);
+static bool writeGolden(const std::string& path, const std::map<std::string, std::string>& entries);
+static bool checkGolden(const std::string& path, const std::map<std::string, std::string>& entries);
+static bool writeCsv(const std::string& path, const std::string& label, const std::vector<BenchRow>& rows);
+static void compareCsv(const std::string& path, const std::vector<BenchRow>& rows);
+
+
+int main(int argc, char** argv) {
+    BenchOptions opts;
+    if (!parseArgs(argc, argv, opts)) { printUsage(argv[0]); return 1; }
+
+    bool ok = true;
+    if (opts.checkKernel) { ok &= checkKernelAgainstReference(); ok &= checkPreprocessAgainstStages(); }
+    if (opts.serializer) ok &= benchSerializer(opts.repeat);
+
+    std::vector<BenchImage> images;
+    for (size_t i = 0; i < opts.megapixels.size(); ++i) {
+        std::ostringstream id; id << "synthetic-" << opts.megapixels[i] << "MP";
+        images.push_back({ id.str(), makeSyntheticImage(opts.megapixels[i], 1234 + i) });
+    }
+    for (const std::string& path : opts.images) {
+        cv::Mat mat = loadImageBgr(path);
+        if (mat.empty()) { std::cerr << "Failed to load image: " << path << std::endl; return 1; }
+        images.push_back({ fs::path(path).filename().string(), mat });
+    }
+    const std::vector<BenchPreset> presets = presetMatrix();
+
+    if (!opts.goldenWritePath.empty() || !opts.goldenCheckPath.empty()) {
+        const std::map<std::string, std::string> entries = goldenEntries(images, presets);
+        if (!opts.goldenWritePath.empty()) ok &= writeGolden(opts.goldenWritePath, entries);
+        if (!opts.goldenCheckPath.empty()) ok &= checkGolden(opts.goldenCheckPath, entries);
+    }
+
+    if (opts.timings) {
+        std::vector<BenchRow> rows;
+        std::cout << std::left << std::setw(22) << "image" << std::setw(16) << "preset" << std::setw(14) << "stage"
+                  << std::right << std::setw(12) << "min ms" << std::setw(12) << "median ms" << std::endl;
+        for (const BenchImage& image : images) {
+            for (const BenchPreset& preset : presets) {
+                for (const BenchRow& row : timeImage(image, preset, opts.repeat)) {
+                    std::cout << std::left << std::setw(22) << row.image << std::setw(16) << row.preset << std::setw(14) << row.stage
+                              << std::right << std::fixed << std::setprecision(3) << std::setw(12) << row.minMs << std::setw(12) << row.medianMs << std::endl;
+                    rows.push_back(row);
+                }
+            }
+        }
+        if (!opts.csvPath.empty()) ok &= writeCsv(opts.csvPath, opts.label, rows);
+        if (!opts.comparePath.empty()) compareCsv(opts.comparePath, rows);
+    }
+    return ok ? 0 : 1;
+}
+
+
+static void printUsage(const char* exe) {
+    std::cerr << "Usage: " << exe << " [options]\n"
+                 "  --sizes <mp,mp,...>     Synthetic image sizes in megapixels (default: 0.25,1,4,16,100, empty for none)\n"
+                 "  --image <file>          Also benchmark a real image (repeatable)\n"
+                 "  --repeat <n>            Runs per image/preset, min and median are reported (default: 3)\n"
+                 "  --csv <file>            Write results as CSV (label,image,megapixels,preset,stage,min_ms,median_ms)\n"
+                 "  --label <text>          Label for the CSV rows, e.g. a commit hash (default: current)\n"
+                 "  --compare <file>        Print median changes against an earlier --csv file\n"
+                 "  --golden-write <file>   Write hashes of the block coordinates and pixel-art Mat per image/preset\n"
+                 "  --golden-check <file>   Compare against a golden file, exit code 1 on any difference\n"
+                 "  --check-kernel          Check pixelateEdges (coordinates, BlockGrid, raster rebuilt from it) against the\n"
+                 "                          reference loop (pixel sizes 2-50, odd sizes)\n"
+                 "                          and the fused preprocessing pass against the separate stages\n"
+                 "  --serializer            Compare coordinate serializer throughput with the original generateCode\n"
+                 "  --no-timings            Skip the pipeline timing runs\n";
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](std::string& out) {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << arg << std::endl; return false; }
+            out = argv[++i]; return true;
+        };
+        std::string value;
+        try {
+            if (arg == "--sizes") {
+                if (!next(value)) return false;
+                opts.megapixels.clear();
+                std::stringstream list(value);
+                for (std::string item; std::getline(list, item, ',');) { if (!item.empty()) opts.megapixels.push_back(std::stod(item)); }
+            }
+            else if (arg == "--image") { if (!next(value)) return false; opts.images.push_back(value); }
+            else if (arg == "--repeat") { if (!next(value)) return false; opts.repeat = std::max(1, std::stoi(value)); }
+            else if (arg == "--csv") { if (!next(opts.csvPath)) return false; }
+            else if (arg == "--label") { if (!next(opts.label)) return false; }
+            else if (arg == "--compare") { if (!next(opts.comparePath)) return false; }
+            else if (arg == "--golden-write") { if (!next(opts.goldenWritePath)) return false; }
+            else if (arg == "--golden-check") { if (!next(opts.goldenCheckPath)) return false; }
+            else if (arg == "--check-kernel") { opts.checkKernel = true; }
+            else if (arg == "--serializer") { opts.serializer = true; }
+            else if (arg == "--no-timings") { opts.timings = false; }
+            else { std::cerr << "Unknown option: " << arg << std::endl; return false; }
+        }
+        catch (const std::exception&) { std::cerr << "Invalid value for " << arg << ": " << value << std::endl; return false; }
+    }
+    return true;
+}
+
+// Deterministic test card: gradient background, random shapes and a little noise, so every stage has real work
+static cv::Mat makeSyntheticImage(double megapixels, std::uint64_t seed) {
+    const int width = std::max(16, static_cast<int>(std::round(std::sqrt(megapixels * 1e6 * 4.0 / 3.0))));
+    const int height = std::max(12, width * 3 / 4);
+    cv::Mat image(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y) {
+        std::uint8_t* row = image.ptr<std::uint8_t>(y);
+        for (int x = 0; x < width; ++x) {
+            row[3 * x + 0] = static_cast<std::uint8_t>(255 * x / width);
+            row[3 * x + 1] = static_cast<std::uint8_t>(255 * y / height);
+            row[3 * x + 2] = static_cast<std::uint8_t>(128 + 64 * ((x / 64 + y / 64) % 2));
+        }
+    }
+
+    cv::RNG rng(seed);
+    const int shapes = std::max(20, static_cast<int>(40 * megapixels));
+    for (int i = 0; i < shapes; ++i) {
+        const cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        const cv::Point a(rng.uniform(0, width), rng.uniform(0, height));
+        const int size = rng.uniform(width / 50 + 1, width / 8 + 2);
+        switch (i % 3) {
+        case 0: cv::circle(image, a, size, color, cv::FILLED); break;
+        case 1: cv::rectangle(image, a, cv::Point(a.x + size, a.y + size / 2), color, cv::FILLED); break;
+        default: cv::line(image, a, cv::Point(rng.uniform(0, width), rng.uniform(0, height)), color, std::max(1, size / 10)); break;
+        }
+    }
+    cv::Mat noise(height, width, CV_8UC3);
+    rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(16));
+    cv::add(image, noise, image);
+    return image;
+}
+
+// Parameter matrix: the defaults plus presets that switch on each optional stage
+static std::vector<BenchPreset> presetMatrix() {
+    std::vector<BenchPreset> presets;
+    presets.push_back({ "default", ProcessingParams() });
+
+    ProcessingParams fullRes; fullRes.scale = 1.0f;
+    presets.push_back({ "full-res", fullRes });
+
+    ProcessingParams blurred = fullRes; blurred.applyBlur = true; blurred.blurKernel = 5;
+    presets.push_back({ "blur5", blurred });
+
+    ProcessingParams adjusted = fullRes; adjusted.contrast = 1.5f; adjusted.brightness = 20; adjusted.flipV = true; adjusted.flipH = true;
+    presets.push_back({ "adjust-flip", adjusted });
+
+    ProcessingParams fine = fullRes; fine.pixelSize = 2; fine.cannyLow = 20; fine.cannyHigh = 60;
+    presets.push_back({ "fine-blocks", fine });
+
+    ProcessingParams coarse; coarse.scale = 1.5f; coarse.pixelSize = 32;
+    presets.push_back({ "upscale-coarse", coarse });
+    return presets;
+}
+
+static std::vector<BenchRow> timeImage(const BenchImage& image, const BenchPreset& preset, int repeat) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::vector<double>> samples(stageNameCount);
+    // Stage buffers are recycled between runs like in the GUI and batch tool, so repeats measure the warm path
+    ProcessingContext workspace;
+
+    for (int run = 0; run < repeat; ++run) {
+        cv::Mat input = image.mat, scaled;
+        for (int stage = ProcessingCache::StageScale; stage <= ProcessingCache::StageCanny; ++stage) {
+            cv::Mat output;
+            const auto start = Clock::now();
+            runPipelineStage(stage, input, output, preset.params, &workspace);
+            samples[stage].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            if (stage == ProcessingCache::StageScale) scaled = output;
+            input = output;
+        }
+        {
+            cv::Mat gray;
+            const auto start = Clock::now();
+            preprocessFused(scaled, gray, preset.params, &workspace);
+            samples[fusedRow].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        cv::Mat pixelArtMat = workspace.acquire(input.size(), CV_8UC1);
+        std::vector<sf::Vector2i> blockCoords;
+        auto start = Clock::now();
+        pixelateEdges(input, preset.params.pixelSize, pixelArtMat, blockCoords);
+        samples[ProcessingCache::StagePixelate].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        start = Clock::now();
+        const std::string code = generateCode(blockCoords, "csharp");
+        samples[generateCodeRow].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::vector<BenchRow> rows;
+    for (int stage = 0; stage < stageNameCount; ++stage) {
+        std::vector<double>& s = samples[stage];
+        std::sort(s.begin(), s.end());
+        BenchRow row;
+        row.image = image.id; row.preset = preset.name; row.stage = stageNames[stage];
+        row.megapixels = image.mat.total() / 1e6;
+        row.minMs = s.front();
+        row.medianMs = s.size() % 2 ? s[s.size() / 2] : 0.5 * (s[s.size() / 2 - 1] + s[s.size() / 2]);
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+static bool checkKernelAgainstReference() {
+    cv::RNG rng(42);
+    std::vector<cv::Mat> edgeMaps;
+    const cv::Size sizes[] = { { 1, 1 }, { 7, 1 }, { 1, 9 }, { 3, 3 }, { 17, 13 }, { 33, 31 }, { 101, 77 }, { 211, 199 }, { 641, 479 } };
+    for (const cv::Size& size : sizes) {
+        for (int percent : { 0, 1, 10, 60 }) {
+            cv::Mat noise(size, CV_8UC1);
+            rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(100));
+            cv::Mat edges = cv::Mat::zeros(size, CV_8UC1);
+            edges.setTo(cv::Scalar(255), noise < percent);
+            edgeMaps.push_back(edges);
+        }
+    }
+    // Real Canny output too, with its long thin runs
+    cv::Mat gray, canny;
+    cv::cvtColor(makeSyntheticImage(0.3, 7), gray, cv::COLOR_BGR2GRAY);
+    cv::Canny(gray, canny, 50, 100, 3, false);
+    edgeMaps.push_back(canny);
+    edgeMaps.push_back(canny({ 1, 1, canny.cols - 3, canny.rows - 2 }).clone());
+
+    int cases = 0, failures = 0;
+    for (const cv::Mat& edges : edgeMaps) {
+        for (int pixelSize = 2; pixelSize <= 50; ++pixelSize) {
+            cv::Mat art, artRef;
+            std::vector<sf::Vector2i> coords, coordsRef, gridCoords;
+            BlockGrid grid;
+            pixelateEdges(edges, pixelSize, art, coords, &grid);
+            pixelateEdgesReference(edges, pixelSize, artRef, coordsRef);
+            grid.appendCoords(gridCoords);
+            cases++;
+            bool same = coords == coordsRef && art.size() == artRef.size() && cv::countNonZero(art != artRef) == 0
+                && gridCoords == coords && grid.size() == blockGridSize(edges.size(), pixelSize);
+            if (same) {
+                cv::Mat artFromGrid;
+                pixelArtFromGrid(grid, edges.size(), pixelSize, artFromGrid);
+                same = cv::countNonZero(artFromGrid != art) == 0;
+            }
+            if (!same) {
+                if (failures < 10) std::cerr << "  kernel mismatch: " << edges.cols << "x" << edges.rows << " pixelSize " << pixelSize << std::endl;
+                failures++;
+            }
+        }
+    }
+    std::cout << "Kernel check (" << pixelateEdgesBackend() << "): " << cases - failures << "/" << cases << " cases match the reference" << std::endl;
+    return failures == 0;
+}
+
+// preprocessFused must equal runPipelineStage over Scale..Gray (scale 1) exactly
+static bool checkPreprocessAgainstStages() {
+    std::vector<cv::Mat> images;
+    const cv::Mat synthetic = makeSyntheticImage(0.3, 11);
+    const cv::Size sizes[] = { { 1, 1 }, { 7, 1 }, { 1, 9 }, { 17, 13 }, { 211, 199 }, { 641, 479 } };
+    for (const cv::Size& size : sizes) {
+        cv::Mat bgr;
+        cv::resize(synthetic, bgr, size, 0, 0, cv::INTER_AREA);
+        cv::Mat bgra, gray;
+        cv::cvtColor(bgr, bgra, cv::COLOR_BGR2BGRA);
+        cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+        images.push_back(bgr); images.push_back(bgra); images.push_back(gray);
+    }
+
+    int cases = 0, failures = 0;
+    for (const cv::Mat& image : images) {
+        for (const std::pair<float, int>& adjust : { std::pair<float, int>{ 1.0f, 0 }, { 1.5f, 20 }, { 0.7f, -35 }, { 2.3f, -90 } }) {
+            for (int flip = 0; flip < 4; ++flip) {
+                for (int blur : { 0, 3, 5, 9 }) {
+                    ProcessingParams params;
+                    params.scale = 1.0f;
+                    params.contrast = adjust.first; params.brightness = adjust.second;
+                    params.flipV = (flip & 1) != 0; params.flipH = (flip & 2) != 0;
+                    params.applyBlur = blur > 0; params.blurKernel = std::max(1, blur);
+
+                    cv::Mat staged = image, fused;
+                    bool ok = true;
+                    for (int stage = ProcessingCache::StageScale; stage <= ProcessingCache::StageGray && ok; ++stage) {
+                        cv::Mat output;
+                        ok = runPipelineStage(stage, staged, output, params);
+                        staged = output;
+                    }
+                    ok = ok && preprocessFused(image, fused, params) && fused.size() == staged.size() && fused.type() == staged.type();
+                    const int diff = ok ? static_cast<int>(cv::norm(fused, staged, cv::NORM_INF)) : 255;
+                    cases++;
+                    if (diff != 0) {
+                        if (failures < 10) {
+                            std::cerr << "  preprocess mismatch: " << image.cols << "x" << image.rows << "x" << image.channels() << " contrast " << params.contrast
+                                      << " brightness " << params.brightness << " flip " << flip << " blur " << blur << ": max diff " << diff << std::endl;
+                        }
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "Preprocess check: " << cases - failures << "/" << cases << " cases match the separate stages" << std::endl;
+    return failures == 0;
+}
+
+static bool benchSerializer(int repeat) {
+    using Clock = std::chrono::steady_clock;
+    auto minMs = [repeat](const auto& run) {
+        double best = 0.0;
+        for (int i = 0; i < repeat; ++i) {
+            const auto start = Clock::now();
+            run();
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            best = i == 0 ? ms : std::min(best, ms);
+        }
+        return best;
+    };
+    auto mbPerSecond = [](size_t bytes, double ms) { return ms > 0.0 ? bytes / 1e3 / ms : 0.0; };
+
+    bool ok = true;
+    std::cout << "\nSerializer throughput (min of " << repeat << "):" << std::endl;
+    std::cout << std::left << std::setw(10) << "blocks" << std::setw(8) << "format" << std::right << std::setw(12) << "bytes"
+              << std::setw(14) << "original ms" << std::setw(10) << "new ms" << std::setw(10) << "MB/s" << std::setw(10) << "speedup" << std::endl;
+    for (size_t count : { size_t(10000), size_t(1000000), size_t(4000000) }) {
+        // Raster-ordered blocks on a 4096-wide grid at 25% density, like a busy edge map
+        const int width = 4096;
+        cv::RNG rng(99);
+        std::vector<sf::Vector2i> coords;
+        coords.reserve(count);
+        for (int y = 0; coords.size() < count; ++y) {
+            for (int x = 0; x < width && coords.size() < count; ++x) { if (rng.uniform(0, 4) == 0) coords.push_back({ x, y }); }
+        }
+        const sf::Vector2i grid(width, coords.back().y + 1);
+
+        for (const char* format : { "csharp", "js", "python", "packed", "spans", "bitset" }) {
+            CoordFormat coordFormat;
+            parseCoordFormat(format, coordFormat);
+            std::string output;
+            const double newMs = minMs([&] { output = generateCode(coords, format, grid); });
+
+            std::cout << std::left << std::setw(10) << count << std::setw(8) << format << std::right << std::setw(12) << output.size() << std::fixed << std::setprecision(2);
+            if (!isBinaryCoordFormat(coordFormat) && coordFormat != CoordFormat::Bitset) {
+                std::string reference;
+                const double referenceMs = minMs([&] { reference = generateCodeReference(coords, format); });
+                if (reference != output) { std::cerr << "  serializer output differs from the original for " << format << std::endl; ok = false; }
+                std::cout << std::setw(14) << referenceMs << std::setw(10) << newMs << std::setw(10) << mbPerSecond(output.size(), newMs)
+                          << std::setw(9) << (newMs > 0.0 ? referenceMs / newMs : 0.0) << "x" << std::endl;
+            }
+            else {
+                std::cout << std::setw(14) << "-" << std::setw(10) << newMs << std::setw(10) << mbPerSecond(output.size(), newMs) << std::setw(10) << "-" << std::endl;
+            }
+        }
+
+        // Streaming straight to disk keeps only one chunk in memory
+        const std::string path = (fs::temp_directory_path() / "edgepixel_bench_coords.cs").string();
+        const double streamMs = minMs([&] { ok &= writeCoordsFile(path, coords, "csharp", grid); });
+        std::error_code ec;
+        const auto fileSize = fs::file_size(path, ec);
+        fs::remove(path, ec);
+        std::cout << std::left << std::setw(10) << count << std::setw(8) << "csharp" << std::right << std::setw(12) << fileSize
+                  << std::setw(14) << "(to file)" << std::setw(10) << streamMs << std::setw(10) << mbPerSecond(fileSize, streamMs) << std::endl;
+    }
+    return ok;
+}
+
+static std::uint64_t fnv1a(const void* data, size_t size, std::uint64_t hash = 14695981039346656037ull) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) { hash ^= bytes[i]; hash *= 1099511628211ull; }
+    return hash;
+}
+
+// "<image> <preset>" -> "<blocks> <coords hash> <pixel-art hash>"
+static std::map<std::string, std::string> goldenEntries(const std::vector<BenchImage>& images, const std::vector<BenchPreset>& presets) {
+    std::map<std::string, std::string> entries;
+    for (const BenchImage& image : images) {
+        for (const BenchPreset& preset : presets) {
+            cv::Mat pixelArtMat;
+            std::vector<sf::Vector2i> blockCoords;
+            processImage(image.mat, pixelArtMat, preset.params, blockCoords);
+
+            std::uint64_t coordsHash = fnv1a(nullptr, 0);
+            for (const sf::Vector2i& c : blockCoords) {
+                const std::int32_t xy[2] = { c.x, c.y };
+                coordsHash = fnv1a(xy, sizeof(xy), coordsHash);
+            }
+            std::uint64_t artHash = fnv1a(nullptr, 0);
+            for (int y = 0; y < pixelArtMat.rows; ++y) artHash = fnv1a(pixelArtMat.ptr(y), pixelArtMat.cols * pixelArtMat.elemSize(), artHash);
+
+            std::ostringstream value;
+            value << blockCoords.size() << " " << std::hex << std::setw(16) << std::setfill('0') << coordsHash
+                  << " " << std::setw(16) << artHash;
+            entries[image.id + " " + preset.name] = value.str();
+        }
+    }
+    return entries;
+}
+
+static bool writeGolden(const std::string& path, const std::map<std::string, std::string>& entries) {
+    std::ofstream file(path);
+    file << "# image preset blocks coords-hash pixel-art-hash\n";
+    for (const auto& entry : entries) file << entry.first << " " << entry.second << "\n";
+    if (!file) { std::cerr << "Failed to write golden file: " << path << std::endl; return false; }
+    std::cout << "Wrote " << entries.size() << " golden entries to " << path << std::endl;
+    return true;
+}
+
+static bool checkGolden(const std::string& path, const std::map<std::string, std::string>& entries) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open golden file: " << path << " (create it with --golden-write, or the golden_update target)" << std::endl;
+        return false;
+    }
+
+    int checked = 0, failures = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string image, preset, blocks, coordsHash, artHash;
+        if (!(fields >> image >> preset >> blocks >> coordsHash >> artHash)) continue;
+        auto it = entries.find(image + " " + preset);
+        if (it == entries.end()) continue; // Image/preset not part of this run
+        checked++;
+        const std::string expected = blocks + " " + coordsHash + " " + artHash;
+        if (it->second != expected) {
+            std::cerr << "  golden mismatch: " << image << " " << preset << ": expected " << expected << ", got " << it->second << std::endl;
+            failures++;
+        }
+    }
+    std::cout << "Golden check: " << checked - failures << "/" << checked << " outputs match " << path << std::endl;
+    if (checked == 0) { std::cerr << "No golden entries matched the images/presets of this run." << std::endl; return false; }
+    return failures == 0;
+}
+
+static bool writeCsv(const std::string& path, const std::string& label, const std::vector<BenchRow>& rows) {
+    std::ofstream file(path);
+    file << "label,image,megapixels,preset,stage,min_ms,median_ms\n";
+    for (const BenchRow& row : rows) {
+        file << label << "," << row.image << "," << row.megapixels << "," << row.preset << "," << row.stage << ","
+             << row.minMs << "," << row.medianMs << "\n";
+    }
+    if (!file) { std::cerr << "Failed to write CSV: " << path << std::endl; return false; }
+    return true;
+}
+
+static void compareCsv(const std::string& path, const std::vector<BenchRow>& rows) {
+    std::ifstream file(path);
+    if (!file) { std::cerr << "Failed to open baseline CSV: " << path << std::endl; return; }
+
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(file, line); // Header
+    while (std::getline(file, line)) {
+        std::vector<std::string> cells;
+        std::stringstream stream(line);
+        for (std::string cell; std::getline(stream, cell, ',');) cells.push_back(cell);
+        if (cells.size() < 7) continue;
+        try { baseline[cells[1] + "/" + cells[3] + "/" + cells[4]] = std::stod(cells[6]); }
+        catch (const std::exception&) {}
+    }
+
+    std::cout << "\nMedian vs " << path << ":" << std::endl;
+    for (const BenchRow& row : rows) {
+        auto it = baseline.find(row.image + "/" + row.preset + "/" + row.stage);
+        if (it == baseline.end() || it->second <= 0.0) continue;
+        std::cout << "  " << std::left << std::setw(22) << row.image << std::setw(16) << row.preset << std::setw(14) << row.stage << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(10) << it->second << " -> " << std::setw(10) << row.medianMs
+                  << "  (" << std::setprecision(2) << row.medianMs / it->second << "x)" << std::endl;
+    }
+}
@@ -0,0 +1,160 @@
+#include "block_grid.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace {
+    inline int popcount64(std::uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<int>(__popcnt64(word));
+#elif defined(_MSC_VER)
+        return static_cast<int>(__popcnt(static_cast<unsigned>(word)) + __popcnt(static_cast<unsigned>(word >> 32)));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    // Index of the lowest set bit; 'word' must be nonzero
+    inline int lowestBit(std::uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index; _BitScanForward64(&index, word); return static_cast<int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(word))) return static_cast<int>(index);
+        _BitScanForward(&index, static_cast<unsigned long>(word >> 32)); return static_cast<int>(index) + 32;
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    // Calls fn(x) for every set bit of a row, left to right
+    template <typename Fn>
+    inline void forEachBit(const std::uint64_t* words, int count, Fn fn) {
+        for (int i = 0; i < count; ++i) {
+            for (std::uint64_t word = words[i]; word; word &= word - 1) fn(i * 64 + lowestBit(word));
+        }
+    }
+}
+
+void BlockGrid::reset(int width, int height) {
+    w = std::max(0, width); h = std::max(0, height);
+    stride = (w + 63) / 64;
+    bits.assign(static_cast<size_t>(stride) * h, 0);
+    litCount = 0;
+}
+
+void BlockGrid::assignMask(const cv::Mat& mask) {
+    CV_Assert(mask.empty() || mask.type() == CV_8UC1);
+    reset(mask.cols, mask.rows);
+    for (int y = 0; y < h; ++y) setRow(y, mask.ptr<std::uint8_t>(y));
+}
+
+void BlockGrid::assignWords(int width, int height, const void* words) {
+    reset(width, height);
+    if (bits.empty()) return;
+    std::memcpy(bits.data(), words, bits.size() * sizeof(std::uint64_t));
+    const std::uint64_t padMask = w % 64 ? (std::uint64_t(1) << (w % 64)) - 1 : ~std::uint64_t(0);
+    for (int y = 0; y < h; ++y) {
+        std::uint64_t* row = bits.data() + static_cast<size_t>(y) * stride;
+        row[stride - 1] &= padMask;
+        for (int i = 0; i < stride; ++i) litCount += popcount64(row[i]);
+    }
+}
+
+void BlockGrid::setRow(int y, const std::uint8_t* flags) {
+    std::uint64_t* row = bits.data() + static_cast<size_t>(y) * stride;
+    for (int i = 0; i < stride; ++i) {
+        litCount -= popcount64(row[i]);
+        const int x0 = i * 64, n = std::min(64, w - x0);
+        std::uint64_t word = 0;
+        for (int b = 0; b < n; ++b) word |= static_cast<std::uint64_t>(flags[x0 + b] != 0) << b;
+        row[i] = word;
+        litCount += popcount64(word);
+    }
+}
+
+void BlockGrid::set(int x, int y, bool lit) {
+    std::uint64_t& word = bits[static_cast<size_t>(y) * stride + (x >> 6)];
+    const std::uint64_t bit = std::uint64_t(1) << (x & 63);
+    if (((word & bit) != 0) == lit) return;
+    word ^= bit;
+    if (lit) litCount++;
+    else litCount--;
+}
+
+size_t BlockGrid::rowCount(int y) const {
+    const std::uint64_t* row = rowWords(y);
+    size_t n = 0;
+    for (int i = 0; i < stride; ++i) n += popcount64(row[i]);
+    return n;
+}
+
+void BlockGrid::appendRowSpans(int y, std::vector<BlockSpan>& out) const {
+    const std::uint64_t* row = rowWords(y);
+    const size_t rowStart = out.size();
+    for (int i = 0; i < stride; ++i) {
+        std::uint64_t word = row[i];
+        while (word) {
+            const int start = lowestBit(word);
+            const std::uint64_t rest = ~(word >> start);
+            const int length = rest ? lowestBit(rest) : 64 - start;
+            const int x0 = i * 64 + start;
+            // Runs that cross a word boundary continue the previous span
+            if (out.size() > rowStart && out.back().x1 == x0) out.back().x1 += length;
+            else out.push_back({ y, x0, x0 + length });
+            word = start + length >= 64 ? 0 : word & ~((std::uint64_t(1) << (start + length)) - 1);
+        }
+    }
+}
+
+void BlockGrid::appendCoords(std::vector<sf::Vector2i>& out) const {
+    out.reserve(out.size() + litCount);
+    for (int y = 0; y < h; ++y) forEachBit(rowWords(y), stride, [&](int x) { out.push_back({ x, y }); });
+}
+
+cv::Mat BlockGrid::toMask() const {
+    cv::Mat mask = cv::Mat::zeros(h, w, CV_8UC1);
+    for (int y = 0; y < h; ++y) {
+        std::uint8_t* out = mask.ptr<std::uint8_t>(y);
+        forEachBit(rowWords(y), stride, [out](int x) { out[x] = 255; });
+    }
+    return mask;
+}
+
+bool BlockGrid::operator==(const BlockGrid& other) const {
+    return w == other.w && h == other.h && litCount == other.litCount && bits == other.bits;
+}
+
+BlockGridDiff diffBlockGrids(const BlockGrid& before, const BlockGrid& after) {
+    BlockGridDiff diff;
+    if (before.size() != after.size()) {
+        diff.resized = true;
+        before.appendCoords(diff.removed);
+        after.appendCoords(diff.added);
+        diff.firstRow = 0; diff.lastRow = after.height() - 1;
+        return diff;
+    }
+
+    // XOR finds the changed words; rows whose words all match cost one compare per word
+    const int stride = after.wordsPerRow();
+    for (int y = 0; y < after.height(); ++y) {
+        const std::uint64_t* a = before.rowWords(y);
+        const std::uint64_t* b = after.rowWords(y);
+        bool rowChanged = false;
+        for (int i = 0; i < stride; ++i) {
+            if (a[i] == b[i]) continue;
+            rowChanged = true;
+            for (std::uint64_t word = b[i] & ~a[i]; word; word &= word - 1) diff.added.push_back({ i * 64 + lowestBit(word), y });
+            for (std::uint64_t word = a[i] & ~b[i]; word; word &= word - 1) diff.removed.push_back({ i * 64 + lowestBit(word), y });
+        }
+        if (rowChanged) {
+            if (diff.lastRow < diff.firstRow) diff.firstRow = y;
+            diff.lastRow = y;
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,72 @@
+// Lit blocks of a pixelation run as a packed bitset, with row spans and diffs between runs
+
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Run of lit blocks [x0, x1) in block row y
+struct BlockSpan {
+    int y = 0, x0 = 0, x1 = 0;
+};
+
+// One bit per block, each row padded to whole 64-bit words so a row can be scanned or compared word by word.
+// test() is O(1) and count() is kept up to date by every write. Iteration is always in raster order, the order
+// pixelateEdges emits coordinates in.
+class BlockGrid {
+public:
+    BlockGrid() = default;
+    BlockGrid(int width, int height) { reset(width, height); }
+
+    // Resizes to width x height blocks, all unlit. Keeps the allocation when it is large enough.
+    void reset(int width, int height);
+    // Replaces the contents with 'mask' (CV_8UC1, one pixel per block, nonzero = lit)
+    void assignMask(const cv::Mat& mask);
+    // Replaces the contents with width x height blocks in rowWords() layout, e.g. read back from disk. Padding bits are ignored.
+    void assignWords(int width, int height, const void* words);
+    // Replaces row y with per-block flags (nonzero = lit), width() of them
+    void setRow(int y, const std::uint8_t* flags);
+    void set(int x, int y, bool lit = true);
+
+    bool test(int x, int y) const { return (bits[static_cast<size_t>(y) * stride + (x >> 6)] >> (x & 63)) & 1u; }
+    size_t count() const { return litCount; }
+    size_t rowCount(int y) const;
+
+    int width() const { return w; }
+    int height() const { return h; }
+    sf::Vector2i size() const { return { w, h }; }
+    size_t memoryBytes() const { return bits.capacity() * sizeof(std::uint64_t); }
+    // Raw bits of row y: wordsPerRow() words, block x at bit x % 64 of word x / 64, padding bits zero
+    const std::uint64_t* rowWords(int y) const { return bits.data() + static_cast<size_t>(y) * stride; }
+    int wordsPerRow() const { return stride; }
+
+    // Appends the maximal runs of lit blocks in row y, left to right
+    void appendRowSpans(int y, std::vector<BlockSpan>& out) const;
+    // Appends every lit block in raster order
+    void appendCoords(std::vector<sf::Vector2i>& out) const;
+    // CV_8UC1, one pixel per block, 255 = lit
+    cv::Mat toMask() const;
+
+    bool operator==(const BlockGrid& other) const;
+    bool operator!=(const BlockGrid& other) const { return !(*this == other); }
+
+private:
+    int w = 0, h = 0;
+    int stride = 0; // Words per row
+    size_t litCount = 0;
+    std::vector<std::uint64_t> bits;
+};
+
+// Changes from one run to the next, both lists in raster order
+struct BlockGridDiff {
+    std::vector<sf::Vector2i> added, removed;
+    int firstRow = 0, lastRow = -1; // Block rows that changed; lastRow < firstRow when none did
+    bool resized = false;           // Different grid sizes: everything in 'before' is removed and everything in 'after' added
+
+    bool empty() const { return added.empty() && removed.empty() && !resized; }
+};
+
+BlockGridDiff diffBlockGrids(const BlockGrid& before, const BlockGrid& after);
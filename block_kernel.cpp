@@ -0,0 +1,203 @@
+#include "block_kernel.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define EDGEPIXEL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define EDGEPIXEL_SSE2 1
+#endif
+
+namespace {
+    const int spacing = 1;
+
+    // True if any of the n bytes at p is nonzero; returns at the first nonzero chunk
+    inline bool anyNonZero(const std::uint8_t* p, int n) {
+        int i = 0;
+#if defined(EDGEPIXEL_AVX2)
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            if (!_mm256_testz_si256(v, v)) return true;
+        }
+#endif
+#if defined(EDGEPIXEL_AVX2) || defined(EDGEPIXEL_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) return true;
+        }
+#endif
+        for (; i + 8 <= n; i += 8) {
+            std::uint64_t word; std::memcpy(&word, p + i, 8);
+            if (word) return true;
+        }
+        for (; i < n; ++i) { if (p[i]) return true; }
+        return false;
+    }
+
+    // acc[i] |= row[i] for the whole row
+    inline void orRow(std::uint8_t* acc, const std::uint8_t* row, int n) {
+        int i = 0;
+#if defined(EDGEPIXEL_AVX2)
+        for (; i + 32 <= n; i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+            __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_or_si256(a, r));
+        }
+#endif
+#if defined(EDGEPIXEL_AVX2) || defined(EDGEPIXEL_SSE2)
+        for (; i + 16 <= n; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_or_si128(a, r));
+        }
+#endif
+        for (; i < n; ++i) acc[i] |= row[i];
+    }
+
+    // Raster rows covered by the block row starting at y: cleared once, then each lit block's inset rectangle is filled
+    void drawBlockRow(cv::Mat& out, int y, int pixelSize, const std::uint8_t* lit, int blocksX) {
+        const int cols = out.cols, rows = out.rows;
+        const int blockH = std::min(pixelSize, rows - y);
+        const int drawW_fixed = std::max(1, pixelSize - 2 * spacing);
+        const int drawH_fixed = std::max(1, pixelSize - 2 * spacing);
+        const int drawY = y + spacing;
+        const bool rectFitsV = drawY + drawH_fixed <= rows;
+        for (int r = y; r < y + blockH; ++r) {
+            std::uint8_t* row = out.ptr<std::uint8_t>(r);
+            std::memset(row, 0, cols);
+            if (!rectFitsV || r < drawY || r >= drawY + drawH_fixed) continue;
+            for (int bx = 0; bx < blocksX; ++bx) {
+                const int drawX = bx * pixelSize + spacing;
+                if (lit[bx] && drawX + drawW_fixed <= cols) std::memset(row + drawX, 255, drawW_fixed);
+            }
+        }
+        // A trailing 1x1 block has no room for the inset rectangle; the original draws the pixel itself
+        if (blockH == 1 && !rectFitsV && blocksX > 0) {
+            const int x = (blocksX - 1) * pixelSize;
+            if (cols - x == 1 && lit[blocksX - 1]) out.ptr<std::uint8_t>(y)[x] = 255;
+        }
+    }
+}
+
+const char* pixelateEdgesBackend() {
+#if defined(EDGEPIXEL_AVX2)
+    return "AVX2";
+#elif defined(EDGEPIXEL_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void pixelateEdges(const cv::Mat& edgeMat, int pixelSize, cv::Mat& outPixelArtMat, std::vector<sf::Vector2i>& outBlockCoords, BlockGrid* outGrid) {
+    CV_Assert(edgeMat.type() == CV_8UC1);
+    outBlockCoords.clear();
+    outPixelArtMat.create(edgeMat.size(), CV_8UC1);
+    pixelSize = std::max(2, pixelSize);
+
+    const int cols = edgeMat.cols, rows = edgeMat.rows;
+    const int blocksX = (cols + pixelSize - 1) / pixelSize;
+    if (outGrid) outGrid->reset(blocksX, (rows + pixelSize - 1) / pixelSize);
+
+    // Small blocks: OR whole rows into an accumulator (fully vectorised) and test blocks once per block row.
+    // Wide blocks: test each block's row segment directly and skip blocks that are already lit.
+    const bool accumulateRows = pixelSize < 16;
+    std::vector<std::uint8_t> acc(accumulateRows ? cols : 0);
+    std::vector<std::uint8_t> lit(blocksX);
+
+    for (int y = 0; y < rows; y += pixelSize) {
+        const int blockH = std::min(pixelSize, rows - y);
+
+        // 1. Occupancy of every block in this block row
+        std::fill(lit.begin(), lit.end(), 0);
+        if (accumulateRows) {
+            std::fill(acc.begin(), acc.end(), 0);
+            for (int r = y; r < y + blockH; ++r) orRow(acc.data(), edgeMat.ptr<std::uint8_t>(r), cols);
+            for (int bx = 0; bx < blocksX; ++bx) {
+                const int x = bx * pixelSize;
+                lit[bx] = anyNonZero(acc.data() + x, std::min(pixelSize, cols - x)) ? 1 : 0;
+            }
+        }
+        else {
+            int remaining = blocksX;
+            for (int r = y; r < y + blockH && remaining > 0; ++r) {
+                const std::uint8_t* row = edgeMat.ptr<std::uint8_t>(r);
+                for (int bx = 0; bx < blocksX; ++bx) {
+                    if (lit[bx]) continue;
+                    const int x = bx * pixelSize;
+                    if (anyNonZero(row + x, std::min(pixelSize, cols - x))) { lit[bx] = 1; --remaining; }
+                }
+            }
+        }
+
+        // 2. Coordinates, in the same raster order as before
+        for (int bx = 0; bx < blocksX; ++bx) {
+            if (lit[bx]) outBlockCoords.push_back({ bx, y / pixelSize });
+        }
+        if (outGrid) outGrid->setRow(y / pixelSize, lit.data());
+
+        // 3. Raster rows covered by this block row
+        drawBlockRow(outPixelArtMat, y, pixelSize, lit.data(), blocksX);
+    }
+}
+
+void pixelArtFromGrid(const BlockGrid& grid, cv::Size edgeSize, int pixelSize, cv::Mat& outPixelArtMat) {
+    pixelSize = std::max(2, pixelSize);
+    CV_Assert(grid.size() == blockGridSize(edgeSize, pixelSize));
+    outPixelArtMat.create(edgeSize, CV_8UC1);
+    std::vector<std::uint8_t> lit(grid.width());
+    for (int by = 0; by < grid.height(); ++by) {
+        for (int bx = 0; bx < grid.width(); ++bx) lit[bx] = grid.test(bx, by) ? 1 : 0;
+        drawBlockRow(outPixelArtMat, by * pixelSize, pixelSize, lit.data(), grid.width());
+    }
+}
+
+sf::Vector2i blockGridSize(cv::Size edgeSize, int pixelSize) {
+    pixelSize = std::max(2, pixelSize);
+    return { (edgeSize.width + pixelSize - 1) / pixelSize, (edgeSize.height + pixelSize - 1) / pixelSize };
+}
+
+sf::Vector2i drawnBlockGridSize(cv::Size edgeSize, int pixelSize) {
+    pixelSize = std::max(2, pixelSize);
+    // Same test as drawBlockRow: block b is drawn if b * pixelSize + spacing + drawSize <= edge
+    const int reach = spacing + std::max(1, pixelSize - 2 * spacing);
+    auto drawn = [&](int edge) { return edge >= reach ? (edge - reach) / pixelSize + 1 : 0; };
+    return { drawn(edgeSize.width), drawn(edgeSize.height) };
+}
+
+cv::Mat blockMaskFromCoords(const std::vector<sf::Vector2i>& blockCoords, cv::Size edgeSize, int pixelSize) {
+    const sf::Vector2i grid = blockGridSize(edgeSize, pixelSize);
+    cv::Mat mask = cv::Mat::zeros(grid.y, grid.x, CV_8UC1);
+    for (const sf::Vector2i& coord : blockCoords) mask.at<std::uint8_t>(coord.y, coord.x) = 255;
+    return mask;
+}
+
+void pixelateEdgesReference(const cv::Mat& edgeMat, int pixelSize, cv::Mat& outPixelArtMat, std::vector<sf::Vector2i>& outBlockCoords) {
+    outBlockCoords.clear();
+    outPixelArtMat = cv::Mat::zeros(edgeMat.size(), CV_8UC1);
+    pixelSize = std::max(2, pixelSize);
+
+    const int drawW_fixed = std::max(1, pixelSize - 2 * spacing);
+    const int drawH_fixed = std::max(1, pixelSize - 2 * spacing);
+
+    for (int y = 0; y < edgeMat.rows; y += pixelSize) {
+        for (int x = 0; x < edgeMat.cols; x += pixelSize) {
+            int blockW = std::min(pixelSize, edgeMat.cols - x); int blockH = std::min(pixelSize, edgeMat.rows - y); if (blockW <= 0 || blockH <= 0) continue;
+            cv::Mat roiEdge = edgeMat({ x, y, blockW, blockH });
+            if (cv::mean(roiEdge)[0] > 0) {
+                outBlockCoords.push_back({ x / pixelSize, y / pixelSize });
+                int drawX = x + spacing; int drawY = y + spacing;
+                if ((drawX + drawW_fixed <= outPixelArtMat.cols) && (drawY + drawH_fixed <= outPixelArtMat.rows)) {
+                    cv::rectangle(outPixelArtMat, { drawX, drawY, drawW_fixed, drawH_fixed }, cv::Scalar(255), cv::FILLED);
+                }
+                else if (blockW == 1 && blockH == 1) { cv::rectangle(outPixelArtMat, { x, y, 1, 1 }, cv::Scalar(255), cv::FILLED); }
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+// Pixelation kernel: turns a Canny edge map into lit pixelSize x pixelSize blocks
+
+#pragma once
+
+#include "block_grid.h"
+
+#include <SFML/System/Vector2.hpp>
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+// Streams the edge map row by row, OR-reducing each row into per-block flags (SSE2/AVX2 when available), and emits
+// outBlockCoords plus the block raster for each block row as soon as it is complete. Output matches pixelateEdgesReference.
+// If 'outGrid' is given it is reset to the block grid and receives the same blocks, one row of flags at a time.
+void pixelateEdges(const cv::Mat& edgeMat, int pixelSize, cv::Mat& outPixelArtMat, std::vector<sf::Vector2i>& outBlockCoords, BlockGrid* outGrid = nullptr);
+
+// The raster pixelateEdges would draw for the blocks in 'grid' on an edge map of 'edgeSize', e.g. for a cached result
+void pixelArtFromGrid(const BlockGrid& grid, cv::Size edgeSize, int pixelSize, cv::Mat& outPixelArtMat);
+
+// Original per-block ROI + cv::mean + cv::rectangle implementation, kept to check the kernel against
+void pixelateEdgesReference(const cv::Mat& edgeMat, int pixelSize, cv::Mat& outPixelArtMat, std::vector<sf::Vector2i>& outBlockCoords);
+
+// Number of blocks across and down for an edge map of 'edgeSize' (partial blocks at the right/bottom edge count)
+sf::Vector2i blockGridSize(cv::Size edgeSize, int pixelSize);
+// The leading part of that grid whose blocks the raster can show: a partial block at the right/bottom edge is only
+// drawn if its rectangle fits inside the edge map, otherwise that strip of the raster stays black even when it is lit
+sf::Vector2i drawnBlockGridSize(cv::Size edgeSize, int pixelSize);
+// Compact form of the pixel-art raster: one pixel per block (CV_8UC1, 255 = lit) for an edge map of 'edgeSize'
+cv::Mat blockMaskFromCoords(const std::vector<sf::Vector2i>& blockCoords, cv::Size edgeSize, int pixelSize);
+
+// Name of the code path pixelateEdges was compiled with ("AVX2", "SSE2" or "scalar")
+const char* pixelateEdgesBackend();
@@ -0,0 +1,254 @@
+#include "coord_serializer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Collects output in a fixed buffer and hands it to the sink whenever it fills up
+    class ChunkWriter {
+    public:
+        static constexpr size_t chunkSize = 64 * 1024;
+
+        explicit ChunkWriter(const CoordSink& sink) : sink(sink), buffer(chunkSize) {}
+
+        void append(const char* data, size_t size) {
+            while (size > 0 && ok) {
+                if (used == chunkSize) flush();
+                const size_t n = std::min(size, chunkSize - used);
+                std::memcpy(buffer.data() + used, data, n);
+                used += n; data += n; size -= n;
+            }
+        }
+        void append(const char* text) { append(text, std::strlen(text)); }
+        void appendInt(long long value) {
+            if (chunkSize - used < 24) flush();
+            const std::to_chars_result result = std::to_chars(buffer.data() + used, buffer.data() + chunkSize, value);
+            used = static_cast<size_t>(result.ptr - buffer.data());
+        }
+        void appendLE(std::uint32_t value, int bytes) {
+            if (chunkSize - used < 4) flush();
+            for (int i = 0; i < bytes; ++i) buffer[used++] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        // Direct access for hot loops: make room for 'maxBytes', write at the returned pointer, then commit the end
+        char* claim(size_t maxBytes) {
+            if (chunkSize - used < maxBytes) flush();
+            return buffer.data() + used;
+        }
+        void commit(char* end) { used = static_cast<size_t>(end - buffer.data()); }
+        bool flush() {
+            if (used > 0 && ok) ok = sink(buffer.data(), used);
+            used = 0;
+            return ok;
+        }
+
+        bool ok = true;
+
+    private:
+        const CoordSink& sink;
+        std::vector<char> buffer;
+        size_t used = 0;
+    };
+
+    struct TextTemplate {
+        const char* header;
+        const char* open;
+        const char* close;
+        const char* footer;
+    };
+
+    const TextTemplate* textTemplate(CoordFormat format) {
+        static const TextTemplate csharp = { "private static readonly List<(int x, int y)> edgePixels = new List<(int x, int y)>\n{\n", "    (", ")", "};" };
+        static const TextTemplate js = { "const edgePixels = [\n", "  [", "]", "];" };
+        static const TextTemplate python = { "edge_pixels = [\n", "    (", ")", "]" };
+        switch (format) {
+        case CoordFormat::CSharp: return &csharp;
+        case CoordFormat::JavaScript: return &js;
+        case CoordFormat::Python: return &python;
+        default: return nullptr;
+        }
+    }
+
+    bool rowMajorLess(const sf::Vector2i& a, const sf::Vector2i& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    }
+
+    void writeBinaryHeader(ChunkWriter& writer, const char* magic, int fieldBytes, sf::Vector2i grid, size_t count) {
+        writer.append(magic, 4);
+        writer.appendLE(1, 2);
+        writer.appendLE(static_cast<std::uint32_t>(fieldBytes), 2);
+        writer.appendLE(static_cast<std::uint32_t>(grid.x), 4);
+        writer.appendLE(static_cast<std::uint32_t>(grid.y), 4);
+        writer.appendLE(static_cast<std::uint32_t>(count), 4);
+    }
+
+    void writeBitset(ChunkWriter& writer, const std::vector<sf::Vector2i>& coords, sf::Vector2i grid) {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const size_t bitCount = static_cast<size_t>(grid.x) * static_cast<size_t>(grid.y);
+        std::vector<std::uint8_t> bits((bitCount + 7) / 8, 0);
+        for (const sf::Vector2i& c : coords) {
+            const size_t bit = static_cast<size_t>(c.y) * grid.x + c.x;
+            bits[bit / 8] |= static_cast<std::uint8_t>(1u << (bit % 8));
+        }
+
+        writer.append("{\"width\": "); writer.appendInt(grid.x);
+        writer.append(", \"height\": "); writer.appendInt(grid.y);
+        writer.append(", \"count\": "); writer.appendInt(static_cast<long long>(coords.size()));
+        writer.append(", \"bits\": \"");
+        size_t i = 0;
+        for (; i + 3 <= bits.size(); i += 3) {
+            const std::uint32_t v = (bits[i] << 16) | (bits[i + 1] << 8) | bits[i + 2];
+            const char quad[4] = { alphabet[(v >> 18) & 63], alphabet[(v >> 12) & 63], alphabet[(v >> 6) & 63], alphabet[v & 63] };
+            writer.append(quad, 4);
+        }
+        if (i < bits.size()) {
+            const bool two = i + 1 < bits.size();
+            const std::uint32_t v = (bits[i] << 16) | (two ? bits[i + 1] << 8 : 0);
+            const char quad[4] = { alphabet[(v >> 18) & 63], alphabet[(v >> 12) & 63], two ? alphabet[(v >> 6) & 63] : '=', '=' };
+            writer.append(quad, 4);
+        }
+        writer.append("\"}\n");
+    }
+}
+
+bool parseCoordFormat(const std::string& id, CoordFormat& outFormat) {
+    if (id == "csharp") outFormat = CoordFormat::CSharp;
+    else if (id == "js") outFormat = CoordFormat::JavaScript;
+    else if (id == "python") outFormat = CoordFormat::Python;
+    else if (id == "packed") outFormat = CoordFormat::PackedBinary;
+    else if (id == "spans") outFormat = CoordFormat::RowSpans;
+    else if (id == "bitset") outFormat = CoordFormat::Bitset;
+    else return false;
+    return true;
+}
+
+bool isBinaryCoordFormat(CoordFormat format) {
+    return format == CoordFormat::PackedBinary || format == CoordFormat::RowSpans;
+}
+
+size_t estimateSerializedSize(size_t coordCount, CoordFormat format, sf::Vector2i gridSize) {
+    switch (format) {
+    case CoordFormat::PackedBinary: return 20 + coordCount * 8;
+    case CoordFormat::RowSpans: return 20 + coordCount * 12;
+    case CoordFormat::Bitset: return 128 + (static_cast<size_t>(std::max(0, gridSize.x)) * std::max(0, gridSize.y) / 8 + 3) * 4 / 3;
+    default: return 128 + coordCount * 20; // "    (12345, 12345),\n"
+    }
+}
+
+bool serializeCoords(const std::vector<sf::Vector2i>& coords, CoordFormat format, const CoordSink& sink, sf::Vector2i gridSize) {
+    ChunkWriter writer(sink);
+
+    if (const TextTemplate* t = textTemplate(format)) {
+        if (coords.empty()) { writer.append("// No edge blocks detected."); return writer.flush(); }
+        writer.append(t->header);
+        const size_t openLength = std::strlen(t->open), closeLength = std::strlen(t->close);
+        const size_t maxRecord = openLength + closeLength + 2 * 11 + 4; // Two ints, ", ", ",\n"
+        for (size_t i = 0; i < coords.size() && writer.ok; ++i) {
+            char* p = writer.claim(maxRecord);
+            std::memcpy(p, t->open, openLength); p += openLength;
+            p = std::to_chars(p, p + 11, coords[i].x).ptr;
+            *p++ = ','; *p++ = ' ';
+            p = std::to_chars(p, p + 11, coords[i].y).ptr;
+            std::memcpy(p, t->close, closeLength); p += closeLength;
+            if (i + 1 < coords.size()) *p++ = ',';
+            *p++ = '\n';
+            writer.commit(p);
+        }
+        writer.append(t->footer);
+        return writer.flush();
+    }
+
+    // Compact formats need the grid and coordinates inside it
+    sf::Vector2i grid = gridSize;
+    if (grid.x <= 0 || grid.y <= 0) {
+        grid = { 0, 0 };
+        for (const sf::Vector2i& c : coords) { grid.x = std::max(grid.x, c.x + 1); grid.y = std::max(grid.y, c.y + 1); }
+    }
+    for (const sf::Vector2i& c : coords) {
+        if (c.x < 0 || c.y < 0 || c.x >= grid.x || c.y >= grid.y) {
+            std::cerr << "serializeCoords: block (" << c.x << ", " << c.y << ") lies outside the " << grid.x << "x" << grid.y << " grid" << std::endl;
+            return false;
+        }
+    }
+    const int fieldBytes = (grid.x <= 0xFFFF && grid.y <= 0xFFFF) ? 2 : 4;
+
+    switch (format) {
+    case CoordFormat::PackedBinary:
+        writeBinaryHeader(writer, "EPXB", fieldBytes, grid, coords.size());
+        for (size_t i = 0; i < coords.size() && writer.ok; ++i) {
+            writer.appendLE(static_cast<std::uint32_t>(coords[i].x), fieldBytes);
+            writer.appendLE(static_cast<std::uint32_t>(coords[i].y), fieldBytes);
+        }
+        break;
+    case CoordFormat::RowSpans: {
+        // pixelateEdges emits unique blocks in raster order already; anything else is sorted and deduplicated, since a
+        // repeated block would otherwise start an overlapping span (sorted input with repeats included)
+        std::vector<sf::Vector2i> sorted;
+        const std::vector<sf::Vector2i>* ordered = &coords;
+        const bool strictlyOrdered = std::adjacent_find(coords.begin(), coords.end(),
+            [](const sf::Vector2i& a, const sf::Vector2i& b) { return !rowMajorLess(a, b); }) == coords.end();
+        if (!strictlyOrdered) {
+            sorted = coords;
+            std::sort(sorted.begin(), sorted.end(), rowMajorLess);
+            sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+            ordered = &sorted;
+        }
+        const std::vector<sf::Vector2i>& list = *ordered;
+        auto continuesRun = [&](size_t i) { return i > 0 && list[i].y == list[i - 1].y && list[i].x == list[i - 1].x + 1; };
+
+        size_t spanCount = 0;
+        for (size_t i = 0; i < list.size(); ++i) if (!continuesRun(i)) spanCount++;
+        writeBinaryHeader(writer, "EPXS", fieldBytes, grid, spanCount);
+        for (size_t start = 0; start < list.size() && writer.ok;) {
+            size_t end = start + 1;
+            while (end < list.size() && continuesRun(end)) ++end;
+            writer.appendLE(static_cast<std::uint32_t>(list[start].y), fieldBytes);
+            writer.appendLE(static_cast<std::uint32_t>(list[start].x), fieldBytes);
+            writer.appendLE(static_cast<std::uint32_t>(end - start), fieldBytes);
+            start = end;
+        }
+        break;
+    }
+    case CoordFormat::Bitset:
+        writeBitset(writer, coords, grid);
+        break;
+    default:
+        return false;
+    }
+    return writer.flush();
+}
+
+bool writeCoordsFile(const std::string& filename, const std::vector<sf::Vector2i>& coords, const std::string& format, sf::Vector2i gridSize) {
+    CoordFormat coordFormat;
+    if (!parseCoordFormat(format, coordFormat)) { std::cerr << "Unknown coordinate format: " << format << std::endl; return false; }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) { std::cerr << "Failed to open " << filename << std::endl; return false; }
+    const bool ok = serializeCoords(coords, coordFormat, [&file](const char* data, size_t size) {
+        file.write(data, static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    }, gridSize);
+    if (!ok || !file) { std::cerr << "Failed to write " << filename << std::endl; return false; }
+    return true;
+}
+
+std::string generateCodeReference(const std::vector<sf::Vector2i>& coords, const std::string& format) {
+    if (coords.empty()) { return "// No edge blocks detected."; }
+    std::string output = "", lineEnding = ",\n";
+    if (format == "csharp") {
+        output += "private static readonly List<(int x, int y)> edgePixels = new List<(int x, int y)>\n{\n";
+        for (size_t i = 0; i < coords.size(); ++i) { output += "    (" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + ")"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "};";
+    }
+    else if (format == "js") {
+        output += "const edgePixels = [\n";
+        for (size_t i = 0; i < coords.size(); ++i) { output += "  [" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + "]"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "];";
+    }
+    else if (format == "python") {
+        output += "edge_pixels = [\n";
+        for (size_t i = 0; i < coords.size(); ++i) { output += "    (" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + ")"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "]";
+    }
+    else { output = "// Unknown format selected"; }
+    return output;
+}
@@ -0,0 +1,44 @@
+// Block coordinate serializer: code templates and compact runtime formats, written in fixed-size chunks
+
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class CoordFormat {
+    CSharp,       // "csharp": List<(int x, int y)> initializer
+    JavaScript,   // "js":     const edgePixels = [[x, y], ...];
+    Python,       // "python": edge_pixels = [(x, y), ...]
+    PackedBinary, // "packed": header + (x, y) pairs
+    RowSpans,     // "spans":  header + (y, x, length) runs of lit blocks along each row; repeated blocks count once
+    Bitset,       // "bitset": JSON with the grid size and a base64 row-major bitset
+};
+
+// Binary layout shared by "packed" and "spans", all fields little-endian:
+//   char magic[4]      "EPXB" (packed) or "EPXS" (spans)
+//   uint16 version     1
+//   uint16 fieldBytes  2, or 4 when the grid is wider or taller than 65535 blocks
+//   uint32 width, height, count
+//   count records of 2 (packed: x, y) or 3 (spans: y, x, length) fields of fieldBytes each
+// The bitset sets bit (y * width + x), least significant bit first within each byte.
+
+// Receives each chunk of output in order; returning false aborts serialization
+using CoordSink = std::function<bool(const char* data, size_t size)>;
+
+bool parseCoordFormat(const std::string& id, CoordFormat& outFormat);
+bool isBinaryCoordFormat(CoordFormat format);
+
+// 'gridSize' is the block grid the coordinates belong to; {0, 0} derives it from the largest coordinate.
+// Only the bitset and the binary headers use it. Returns false on a sink failure or a coordinate outside the grid.
+bool serializeCoords(const std::vector<sf::Vector2i>& coords, CoordFormat format, const CoordSink& sink, sf::Vector2i gridSize = { 0, 0 });
+// Streams straight to disk, so memory use does not grow with the number of blocks
+bool writeCoordsFile(const std::string& filename, const std::vector<sf::Vector2i>& coords, const std::string& format, sf::Vector2i gridSize = { 0, 0 });
+// Upper bound for the output size, used to reserve string capacity
+size_t estimateSerializedSize(size_t coordCount, CoordFormat format, sf::Vector2i gridSize = { 0, 0 });
+
+// Original string-concatenation generateCode (text formats only), kept as the serializer benchmark baseline
+std::string generateCodeReference(const std::vector<sf::Vector2i>& coords, const std::string& format);
@@ -0,0 +1,85 @@
+// Converter daemon: keeps decoded images resident and serves processing requests over a Unix domain socket
+
+#include "daemon_server.h"
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <string>
+
+namespace {
+    DaemonServer* activeServer = nullptr;
+
+    void handleSignal(int) {
+        if (activeServer) activeServer->stop();
+    }
+}
+
+// --- Function Prototypes ---
+static void printUsage(const char* exe);
+static bool parseArgs(int argc, char** argv, DaemonOptions& opts);
+
+
+int main(int argc, char** argv) {
+    DaemonOptions opts;
+    if (!parseArgs(argc, argv, opts)) { printUsage(argv[0]); return 1; }
+
+    DaemonServer server(opts);
+    activeServer = &server;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    const bool ok = server.run();
+    activeServer = nullptr;
+    return ok ? 0 : 2;
+}
+
+
+static void printUsage(const char* exe) {
+    std::cerr << "Usage: " << exe << " [options]\n"
+                 "  --socket <path>        Unix domain socket to listen on (default: edgepixel.sock)\n"
+                 "  -j, --threads <n>      Worker count (default: hardware threads)\n"
+                 "  --memory <MB>          Budget for resident images, least recently used go first (default: 1024)\n"
+                 "  --preset <file>        Default ProcessingParams, which each request's \"params\" override\n"
+                 "  --set <key>=<value>    Override a single default parameter\n"
+                 "Requests are one JSON object per line, e.g.\n"
+                 "  {\"id\":1,\"cmd\":\"load\",\"path\":\"sprite.png\",\"name\":\"sprite\"}\n"
+                 "  {\"id\":2,\"cmd\":\"process\",\"image\":\"sprite\",\"params\":{\"pixelSize\":8},\"format\":\"js\"}\n"
+                 "  {\"id\":3,\"cmd\":\"stats\"}\n"
+                 "Commands: load, process, unload, list, stats, shutdown\n"
+                 "Request paths (load/process \"path\", \"preview\") are trusted: any client can read and write files\n"
+                 "with the daemon's permissions. The socket is created accessible to its owner only; on Windows, put it\n"
+                 "in a directory only you can access.\n";
+}
+
+static bool parseArgs(int argc, char** argv, DaemonOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](std::string& out) {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << arg << std::endl; return false; }
+            out = argv[++i]; return true;
+        };
+        std::string value;
+        if (arg == "--socket") { if (!next(opts.socketPath)) return false; }
+        else if (arg == "-j" || arg == "--threads") {
+            if (!next(value)) return false;
+            try { opts.threads = static_cast<unsigned>(std::max(0, std::stoi(value))); }
+            catch (const std::exception&) { std::cerr << "Invalid thread count: " << value << std::endl; return false; }
+        }
+        else if (arg == "--memory") {
+            if (!next(value)) return false;
+            try { opts.memoryBytes = static_cast<size_t>(std::max(1, std::stoi(value))) << 20; }
+            catch (const std::exception&) { std::cerr << "Invalid memory budget: " << value << std::endl; return false; }
+        }
+        else if (arg == "--preset") { if (!next(value) || !loadPreset(value, opts.params)) return false; }
+        else if (arg == "--set") {
+            if (!next(value)) return false;
+            size_t eq = value.find('=');
+            if (eq == std::string::npos || !setProcessingParam(opts.params, value.substr(0, eq), value.substr(eq + 1))) {
+                std::cerr << "Invalid parameter override: " << value << std::endl; return false;
+            }
+        }
+        else if (arg == "-h" || arg == "--help") { return false; }
+        else { std::cerr << "Unknown option: " << arg << std::endl; return false; }
+    }
+    return true;
+}
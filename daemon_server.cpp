@@ -0,0 +1,391 @@
+#include "daemon_server.h"
+#include "coord_serializer.h"
+#include "json_lite.h"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <winsock2.h>
+    #include <afunix.h> // AF_UNIX sockets, Windows 10 1803 and later
+#else
+    #include <csignal>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    // --- Socket shims ---
+#if defined(_WIN32)
+    using SocketHandle = SOCKET;
+    const SocketHandle invalidSocket = INVALID_SOCKET;
+    const int sendFlags = 0;
+    const int shutdownRead = SD_RECEIVE;
+    inline void closeSocket(SocketHandle socket) { closesocket(socket); }
+    inline int pollSockets(pollfd* fds, unsigned count, int timeoutMs) { return WSAPoll(fds, count, timeoutMs); }
+#else
+    using SocketHandle = int;
+    const SocketHandle invalidSocket = -1;
+    #if defined(MSG_NOSIGNAL)
+    const int sendFlags = MSG_NOSIGNAL;
+    #else
+    const int sendFlags = 0; // SIGPIPE is ignored in run() instead
+    #endif
+    const int shutdownRead = SHUT_RD;
+    inline void closeSocket(SocketHandle socket) { ::close(socket); }
+    inline int pollSockets(pollfd* fds, unsigned count, int timeoutMs) { return ::poll(fds, count, timeoutMs); }
+#endif
+
+    // A client that sends this much without a newline is dropped
+    const size_t maxRequestBytes = size_t(1) << 20;
+
+    void appendField(std::string& out, const char* key) {
+        out += ",\"";
+        out += key;
+        out += "\":";
+    }
+
+    // Milliseconds rounded to microseconds, which is all the precision a latency report needs
+    void appendMs(std::string& out, double ms) { appendJsonNumber(out, std::round(ms * 1000.0) / 1000.0); }
+
+    const std::string* stringMember(const JsonValue& object, const char* key) {
+        const JsonValue* value = object.find(key);
+        return value && value->type == JsonValue::Type::String ? &value->text : nullptr;
+    }
+}
+
+// --- Connection ---
+struct DaemonServer::Connection {
+    explicit Connection(SocketHandle socket) : socket(socket) {}
+    ~Connection() { closeSocket(socket); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Writes one whole response; concurrent workers never interleave their lines
+    bool send(const std::string& data) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const int chunk = static_cast<int>(std::min<size_t>(data.size() - sent, size_t(1) << 20));
+            const auto n = ::send(socket, data.data() + sent, chunk, sendFlags);
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    const SocketHandle socket;
+    std::mutex writeMutex;
+    std::atomic<bool> readerDone{ false }; // The reader thread's last step; it only needs joining after this
+};
+
+// --- LatencyWindow ---
+void LatencyWindow::record(double ms) {
+    samples[next] = static_cast<float>(ms);
+    next = (next + 1) % capacity;
+    count++;
+}
+
+double LatencyWindow::percentile(double fraction) const {
+    const size_t n = std::min(count, capacity);
+    if (n == 0) return 0.0;
+    std::vector<float> sorted(samples.begin(), samples.begin() + n);
+    const size_t index = std::min(n - 1, static_cast<size_t>(std::clamp(fraction, 0.0, 1.0) * (n - 1) + 0.5));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+// --- DaemonServer ---
+DaemonServer::DaemonServer(const DaemonOptions& options)
+    : options(options), images(options.memoryBytes), pool(options.threads), workers(pool.size()) {}
+
+DaemonServer::~DaemonServer() {
+    stop();
+    pool.wait();
+}
+
+bool DaemonServer::run() {
+#if defined(_WIN32)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) { std::cerr << "Failed to initialise Winsock" << std::endl; return false; }
+    struct WinsockGuard { ~WinsockGuard() { WSACleanup(); } } winsockGuard;
+#else
+    std::signal(SIGPIPE, SIG_IGN); // A client hanging up mid-response must not kill the daemon
+#endif
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid socket path: " << options.socketPath << std::endl; return false;
+    }
+    std::memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+
+    // 1. Refuse to take over the socket of a daemon that is still running, but clear a stale one left by a crash
+    SocketHandle listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == invalidSocket) { std::cerr << "Failed to create socket" << std::endl; return false; }
+    if (::connect(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        std::cerr << "Another daemon is already listening on " << options.socketPath << std::endl;
+        closeSocket(listener); return false;
+    }
+    closeSocket(listener);
+    std::remove(options.socketPath.c_str());
+
+    // 2. Bind and listen. Requests name files to read and write, so the socket must never be reachable by other users:
+    // it is created owner-only under a restrictive umask rather than tightened after bind(), which would leave a window.
+    // On Windows the socket file inherits the directory's ACL, so it should live in a per-user directory.
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+#if !defined(_WIN32)
+    const mode_t previousMask = ::umask(0077);
+#endif
+    const bool bound = listener != invalidSocket && ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+#if !defined(_WIN32)
+    ::umask(previousMask);
+#endif
+    if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Failed to listen on " << options.socketPath << std::endl;
+        if (listener != invalidSocket) closeSocket(listener);
+        return false;
+    }
+
+    // Parallelism comes from the pool; letting OpenCV spawn its own threads on top only oversubscribes the cores
+    if (pool.size() > 1) cv::setNumThreads(1);
+    std::cout << "Listening on " << options.socketPath << " with " << pool.size() << " worker(s), "
+              << (options.memoryBytes >> 20) << " MB for resident images" << std::endl;
+
+    // 3. Accept until stopped. The timeout bounds how long a stop() from a handler or a signal takes to be noticed.
+    while (!stopping.load()) {
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->connection->readerDone.load()) { it->thread.join(); it = connections.erase(it); }
+            else { ++it; }
+        }
+
+        pollfd fd{};
+        fd.fd = listener;
+        fd.events = POLLIN;
+        if (pollSockets(&fd, 1, 200) <= 0 || !(fd.revents & POLLIN)) continue;
+        const SocketHandle client = ::accept(listener, nullptr, nullptr);
+        if (client == invalidSocket) continue;
+
+        auto connection = std::make_shared<Connection>(client);
+        connections.push_back({ connection, std::thread([this, connection] { serveConnection(connection); }) });
+    }
+    closeSocket(listener);
+
+    // 4. Stop reading requests and join the readers. Responses still being computed are written before their
+    // connections close.
+    for (Reader& reader : connections) ::shutdown(reader.connection->socket, shutdownRead);
+    for (Reader& reader : connections) reader.thread.join();
+    connections.clear();
+    pool.wait();
+    std::remove(options.socketPath.c_str());
+    std::cout << "Daemon stopped after " << served.load() << " request(s), " << failed.load() << " failed" << std::endl;
+    return true;
+}
+
+void DaemonServer::serveConnection(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    std::vector<char> chunk(64 * 1024);
+    while (!stopping.load()) {
+        const auto n = ::recv(connection->socket, chunk.data(), static_cast<int>(chunk.size()), 0);
+        if (n <= 0) break;
+        buffer.append(chunk.data(), static_cast<size_t>(n));
+
+        size_t start = 0, end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+            std::string line = buffer.substr(start, end - start);
+            start = end + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+            const Clock::time_point received = Clock::now();
+            inFlight++;
+            pool.submit([this, connection, line = std::move(line), received] {
+                std::string command;
+                std::string response = handleRequest(line, command);
+                response += '\n';
+                connection->send(response);
+                recordLatency(command, std::chrono::duration<double, std::milli>(Clock::now() - received).count());
+                inFlight--;
+            });
+        }
+        buffer.erase(0, start);
+        if (buffer.size() > maxRequestBytes) {
+            connection->send("{\"id\":null,\"ok\":false,\"error\":\"request too large\"}\n");
+            break;
+        }
+    }
+
+    connection->readerDone.store(true);
+}
+
+std::string DaemonServer::handleRequest(const std::string& line, std::string& outCommand) {
+    std::string response = "{\"id\":";
+    std::string body, error;
+    JsonValue request;
+    outCommand = "invalid";
+    bool ok = false;
+
+    if (!parseJson(line, request, error)) { error = "invalid JSON: " + error; response += "null"; }
+    else {
+        // Echo the id as sent, so clients can match out-of-order responses
+        const JsonValue* id = request.find("id");
+        if (id && id->type == JsonValue::Type::String) appendJsonString(response, id->text);
+        else if (id && id->type == JsonValue::Type::Number) appendJsonNumber(response, id->number);
+        else response += "null";
+
+        const std::string* command = stringMember(request, "cmd");
+        const std::string name = command ? *command : std::string();
+        if (name == "load") ok = handleLoad(request, body, error);
+        else if (name == "process") ok = handleProcess(request, body, error);
+        else if (name == "unload") {
+            const std::string* image = stringMember(request, "name");
+            ok = image && images.erase(*image);
+            if (!ok) error = image ? "image not resident: " + *image : "unload needs \"name\"";
+        }
+        else if (name == "list") {
+            appendField(body, "images");
+            body += '[';
+            for (const StoredImageInfo& info : images.list()) {
+                if (body.back() != '[') body += ',';
+                body += "{\"name\":"; appendJsonString(body, info.name);
+                body += ",\"path\":"; appendJsonString(body, info.path);
+                body += ",\"width\":" + std::to_string(info.size.width) + ",\"height\":" + std::to_string(info.size.height);
+                body += ",\"bytes\":" + std::to_string(info.bytes) + "}";
+            }
+            body += ']';
+            ok = true;
+        }
+        else if (name == "stats") { appendStats(body); ok = true; }
+        else if (name == "shutdown") { stop(); ok = true; }
+        else error = command ? "unknown command: " + name : "missing \"cmd\"";
+
+        // Only known commands get a latency window, so clients cannot grow the table
+        if (ok || name == "load" || name == "process" || name == "unload") outCommand = name;
+    }
+
+    if (ok) { response += ",\"ok\":true"; served++; }
+    else {
+        response += ",\"ok\":false,\"error\":";
+        appendJsonString(response, error);
+        failed++;
+    }
+    response += body;
+    response += '}';
+    return response;
+}
+
+bool DaemonServer::handleLoad(const JsonValue& request, std::string& response, std::string& error) {
+    const std::string* path = stringMember(request, "path");
+    if (!path) { error = "load needs \"path\""; return false; }
+    const std::string* name = stringMember(request, "name");
+
+    cv::Mat image;
+    if (!images.load(name ? *name : *path, *path, &image)) { error = "failed to load image: " + *path; return false; }
+    appendField(response, "name"); appendJsonString(response, name ? *name : *path);
+    response += ",\"width\":" + std::to_string(image.cols) + ",\"height\":" + std::to_string(image.rows);
+    response += ",\"bytes\":" + std::to_string(image.total() * image.elemSize());
+    return true;
+}
+
+bool DaemonServer::handleProcess(const JsonValue& request, std::string& response, std::string& error) {
+    // 1. Resolve the source image; a path that is not resident yet is loaded and stays resident under its path
+    const std::string* name = stringMember(request, "image");
+    const std::string* path = stringMember(request, "path");
+    if (!name && !path) { error = "process needs \"image\" or \"path\""; return false; }
+    const std::string key = name ? *name : *path;
+    cv::Mat image = images.get(key);
+    if (image.empty()) {
+        if (name) { error = "image not resident: " + *name; return false; }
+        if (!images.load(key, *path, &image)) { error = "failed to load image: " + *path; return false; }
+    }
+
+    // 2. Params on top of the daemon defaults, with the same keys and value rules as preset files
+    ProcessingParams params = options.params;
+    if (const JsonValue* overrides = request.find("params")) {
+        if (overrides->type != JsonValue::Type::Object) { error = "\"params\" must be an object"; return false; }
+        for (const auto& member : overrides->members) {
+            if (!setProcessingParam(params, member.first, member.second.scalarText())) { error = "invalid parameter: " + member.first; return false; }
+        }
+    }
+    const std::string* format = stringMember(request, "format");
+    CoordFormat coordFormat = CoordFormat::CSharp;
+    if (format && !parseCoordFormat(*format, coordFormat)) { error = "unknown format: " + *format; return false; }
+
+    // 3. Run on this worker's cache. Requests for the same image and params reuse its stage outputs; the cache keeps a
+    // reference to the last source, so an evicted image is only freed once this worker moves on to another one.
+    WorkerState& state = workers[pool.currentWorkerIndex()];
+    const Clock::time_point start = Clock::now();
+    if (!processImage(image, state.pixelArtMat, params, state.blockCoords, state.cache) || state.pixelArtMat.empty()) {
+        error = "processing failed"; return false;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    const BlockGrid& grid = state.cache.blocks();
+
+    appendField(response, "image"); appendJsonString(response, key);
+    response += ",\"width\":" + std::to_string(image.cols) + ",\"height\":" + std::to_string(image.rows);
+    response += ",\"grid\":[" + std::to_string(grid.width()) + "," + std::to_string(grid.height()) + "]";
+    response += ",\"blocks\":" + std::to_string(state.blockCoords.size());
+    appendField(response, "ms"); appendMs(response, ms);
+
+    if (const std::string* preview = stringMember(request, "preview")) {
+        if (!cv::imwrite(*preview, state.pixelArtMat)) { error = "failed to write preview: " + *preview; response.clear(); return false; }
+    }
+    if (format) {
+        const std::string code = generateCode(state.blockCoords, *format, grid.size());
+        appendField(response, "format"); appendJsonString(response, *format);
+        appendField(response, "code");
+        if (isBinaryCoordFormat(coordFormat)) {
+            appendJsonBase64(response, code.data(), code.size());
+            response += ",\"encoding\":\"base64\"";
+        }
+        else appendJsonString(response, code);
+    }
+    return true;
+}
+
+void DaemonServer::recordLatency(const std::string& command, double ms) {
+    std::lock_guard<std::mutex> lock(latencyMutex);
+    latencies[command].record(ms);
+}
+
+void DaemonServer::appendStats(std::string& response) {
+    response += ",\"images\":" + std::to_string(images.count());
+    response += ",\"residentBytes\":" + std::to_string(images.residentBytes());
+    response += ",\"budgetBytes\":" + std::to_string(images.budget());
+    response += ",\"evictions\":" + std::to_string(images.evictions());
+    response += ",\"workers\":" + std::to_string(pool.size());
+    response += ",\"inFlight\":" + std::to_string(inFlight.load());
+    response += ",\"served\":" + std::to_string(served.load());
+    response += ",\"failed\":" + std::to_string(failed.load());
+
+    // Request latency from the moment the line was read to the moment the response was written, queueing included
+    appendField(response, "latencyMs");
+    response += '{';
+    std::lock_guard<std::mutex> lock(latencyMutex);
+    for (const auto& entry : latencies) {
+        if (response.back() != '{') response += ',';
+        appendJsonString(response, entry.first);
+        response += ":{\"count\":" + std::to_string(entry.second.total());
+        response += ",\"p50\":"; appendMs(response, entry.second.percentile(0.50));
+        response += ",\"p90\":"; appendMs(response, entry.second.percentile(0.90));
+        response += ",\"p99\":"; appendMs(response, entry.second.percentile(0.99));
+        response += ",\"max\":"; appendMs(response, entry.second.percentile(1.0));
+        response += '}';
+    }
+    response += '}';
+}
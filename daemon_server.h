@@ -0,0 +1,105 @@
+// Long-running converter daemon: resident images and a newline-delimited JSON protocol over a Unix domain socket
+
+#pragma once
+
+#include "processing.h"
+#include "image_store.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct JsonValue;
+
+struct DaemonOptions {
+    std::string socketPath = "edgepixel.sock";
+    unsigned threads = 0;                 // 0 = one per hardware thread
+    size_t memoryBytes = size_t(1) << 30; // Budget for resident images
+    ProcessingParams params;              // Defaults that each "process" request's "params" are applied on top of
+};
+
+// Latencies of the most recent requests of one command, for percentile reporting
+class LatencyWindow {
+public:
+    static constexpr size_t capacity = 1024;
+
+    void record(double ms);
+    size_t total() const { return count; }
+    // 'fraction' in [0, 1] over the samples still in the window, 0 if there are none
+    double percentile(double fraction) const;
+
+private:
+    std::array<float, capacity> samples{};
+    size_t next = 0, count = 0;
+};
+
+// Every connection gets a reader thread that splits its input into lines; each line is one request, handed to the
+// worker pool, so requests from one client run concurrently and their responses can come back in any order.
+// Responses echo the request's "id" so clients can match them. Commands:
+//   load     {"path", "name"?}                    Decode and keep resident (name defaults to the path)
+//   process  {"image" | "path", "params"?, "format"?, "preview"?}
+//            Runs processImage on a resident image ("path" loads it first if needed). "params" holds ProcessingParams
+//            keys as in presets; "format" returns the generateCode output, base64 encoded for binary formats;
+//            "preview" writes the pixel-art PNG to that file.
+//   unload   {"name"}
+//   list, stats, shutdown
+class DaemonServer {
+public:
+    explicit DaemonServer(const DaemonOptions& options);
+    ~DaemonServer();
+
+    DaemonServer(const DaemonServer&) = delete;
+    DaemonServer& operator=(const DaemonServer&) = delete;
+
+    // Binds the socket and serves until a "shutdown" request or stop(). False if the socket cannot be set up.
+    bool run();
+    // Safe to call from any thread, including a request handler
+    void stop() { stopping.store(true); }
+
+private:
+    struct Connection;
+    using Clock = std::chrono::steady_clock;
+
+    void serveConnection(std::shared_ptr<Connection> connection);
+    // Builds the full response line (without the newline) for one request line
+    std::string handleRequest(const std::string& line, std::string& outCommand);
+    void recordLatency(const std::string& command, double ms);
+
+    bool handleLoad(const JsonValue& request, std::string& response, std::string& error);
+    bool handleProcess(const JsonValue& request, std::string& response, std::string& error);
+    void appendStats(std::string& response);
+
+    DaemonOptions options;
+    ImageStore images;
+    ThreadPool pool;
+
+    // Per-worker state, indexed by pool.currentWorkerIndex()
+    struct WorkerState {
+        ProcessingCache cache;
+        cv::Mat pixelArtMat;
+        std::vector<sf::Vector2i> blockCoords;
+    };
+    std::vector<WorkerState> workers;
+
+    std::atomic<bool> stopping{ false };
+    std::atomic<size_t> inFlight{ 0 }, served{ 0 }, failed{ 0 };
+
+    std::mutex latencyMutex;
+    std::map<std::string, LatencyWindow> latencies; // Guarded by latencyMutex
+
+    // Open connections and their reader threads, only touched by run(). Readers that have finished are joined by the
+    // accept loop and the rest before run() returns, so no reader outlives the server.
+    struct Reader {
+        std::shared_ptr<Connection> connection;
+        std::thread thread;
+    };
+    std::vector<Reader> connections;
+};
@@ -0,0 +1,89 @@
+#include "image_store.h"
+#include "processing.h"
+
+#include <iostream>
+
+ImageStore::ImageStore(size_t budgetBytes) : budgetBytes(budgetBytes) {}
+
+bool ImageStore::load(const std::string& name, const std::string& path, cv::Mat* outImage) {
+    cv::Mat image = loadImageBgr(path);
+    if (image.empty()) { std::cerr << "Failed to load image: " << path << std::endl; return false; }
+    insert(name, path, image);
+    if (outImage) *outImage = image;
+    return true;
+}
+
+void ImageStore::insert(const std::string& name, const std::string& path, const cv::Mat& image) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = slots.find(name);
+    if (it == slots.end()) {
+        order.push_front(name);
+        it = slots.emplace(name, Slot()).first;
+        it->second.position = order.begin();
+    }
+    else {
+        bytes -= it->second.info.bytes;
+        order.splice(order.begin(), order, it->second.position);
+    }
+
+    Slot& slot = it->second;
+    slot.image = image;
+    slot.info.name = name; slot.info.path = path;
+    slot.info.size = image.size();
+    slot.info.bytes = image.total() * image.elemSize();
+    bytes += slot.info.bytes;
+    evictLocked(name);
+}
+
+cv::Mat ImageStore::get(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = slots.find(name);
+    if (it == slots.end()) return cv::Mat();
+    order.splice(order.begin(), order, it->second.position);
+    return it->second.image;
+}
+
+bool ImageStore::erase(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = slots.find(name);
+    if (it == slots.end()) return false;
+    bytes -= it->second.info.bytes;
+    order.erase(it->second.position);
+    slots.erase(it);
+    return true;
+}
+
+void ImageStore::evictLocked(const std::string& keep) {
+    while (bytes > budgetBytes && !order.empty()) {
+        const std::string& oldest = order.back();
+        if (oldest == keep) break; // Only the new image is left
+        auto it = slots.find(oldest);
+        bytes -= it->second.info.bytes;
+        slots.erase(it);
+        order.pop_back();
+        evictionCount++;
+    }
+}
+
+std::vector<StoredImageInfo> ImageStore::list() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<StoredImageInfo> result;
+    result.reserve(order.size());
+    for (const std::string& name : order) result.push_back(slots.at(name).info);
+    return result;
+}
+
+size_t ImageStore::count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
+
+size_t ImageStore::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+size_t ImageStore::evictions() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return evictionCount;
+}
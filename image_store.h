@@ -0,0 +1,58 @@
+// Decoded source images kept resident between daemon requests, bounded by a memory budget
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct StoredImageInfo {
+    std::string name;
+    std::string path;
+    cv::Size size;
+    size_t bytes = 0;
+};
+
+// Named originalMats in least-recently-used order. Inserting past the budget evicts the oldest images; an image larger
+// than the whole budget is still kept, on its own. get() returns a shallow Mat, so a request that is still using an
+// image keeps its pixels alive after eviction; only the store's own reference goes. Thread-safe.
+class ImageStore {
+public:
+    explicit ImageStore(size_t budgetBytes);
+
+    // Decodes 'path' in the BGR layout loadImage produces and stores it under 'name', replacing any image of that name.
+    // Decoding happens outside the lock. 'outImage' receives the decoded image even if it is evicted again right away.
+    // False if the file cannot be decoded.
+    bool load(const std::string& name, const std::string& path, cv::Mat* outImage = nullptr);
+    void insert(const std::string& name, const std::string& path, const cv::Mat& image);
+    // Marks the image most recently used. Empty if 'name' is not resident.
+    cv::Mat get(const std::string& name);
+    bool erase(const std::string& name);
+
+    std::vector<StoredImageInfo> list() const; // Most recently used first
+    size_t count() const;
+    size_t residentBytes() const;
+    size_t budget() const { return budgetBytes; }
+    size_t evictions() const;
+
+private:
+    struct Slot {
+        StoredImageInfo info;
+        cv::Mat image;
+        std::list<std::string>::iterator position;
+    };
+    // Drops least recently used images other than 'keep' until the store fits the budget. Caller holds the mutex.
+    void evictLocked(const std::string& keep);
+
+    const size_t budgetBytes;
+    mutable std::mutex mutex;
+    std::list<std::string> order; // Most recently used first
+    std::unordered_map<std::string, Slot> slots;
+    size_t bytes = 0;
+    size_t evictionCount = 0;
+};
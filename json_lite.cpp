@@ -0,0 +1,235 @@
+#include "json_lite.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <locale>
+#include <sstream>
+
+namespace {
+    const int maxDepth = 64;
+
+    struct Parser {
+        explicit Parser(const std::string& text) : text(text) {}
+
+        const std::string& text;
+        size_t pos = 0;
+        std::string error;
+
+        bool fail(const std::string& message) {
+            if (error.empty()) error = message + " at offset " + std::to_string(pos);
+            return false;
+        }
+        void skipSpace() { while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) pos++; }
+        bool consume(const char* literal) {
+            size_t n = 0;
+            while (literal[n]) n++;
+            if (text.compare(pos, n, literal) != 0) return false;
+            pos += n;
+            return true;
+        }
+
+        bool parseValue(JsonValue& out, int depth) {
+            if (depth > maxDepth) return fail("nesting too deep");
+            skipSpace();
+            if (pos >= text.size()) return fail("unexpected end of input");
+            const char c = text[pos];
+            if (c == '{') return parseObject(out, depth);
+            if (c == '[') return parseArray(out, depth);
+            if (c == '"') { out.type = JsonValue::Type::String; return parseString(out.text); }
+            if (consume("true")) { out.type = JsonValue::Type::Bool; out.boolean = true; return true; }
+            if (consume("false")) { out.type = JsonValue::Type::Bool; out.boolean = false; return true; }
+            if (consume("null")) { out.type = JsonValue::Type::Null; return true; }
+            if (c == '-' || (c >= '0' && c <= '9')) return parseNumber(out);
+            return fail(std::string("unexpected character '") + c + "'");
+        }
+
+        bool parseObject(JsonValue& out, int depth) {
+            out.type = JsonValue::Type::Object;
+            pos++; // '{'
+            skipSpace();
+            if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+            while (true) {
+                skipSpace();
+                if (pos >= text.size() || text[pos] != '"') return fail("expected member name");
+                std::string key;
+                if (!parseString(key)) return false;
+                skipSpace();
+                if (pos >= text.size() || text[pos] != ':') return fail("expected ':'");
+                pos++;
+                out.members.emplace_back(std::move(key), JsonValue());
+                if (!parseValue(out.members.back().second, depth + 1)) return false;
+                skipSpace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == '}') { pos++; return true; }
+                return fail("expected ',' or '}'");
+            }
+        }
+
+        bool parseArray(JsonValue& out, int depth) {
+            out.type = JsonValue::Type::Array;
+            pos++; // '['
+            skipSpace();
+            if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+            while (true) {
+                out.items.emplace_back();
+                if (!parseValue(out.items.back(), depth + 1)) return false;
+                skipSpace();
+                if (pos < text.size() && text[pos] == ',') { pos++; continue; }
+                if (pos < text.size() && text[pos] == ']') { pos++; return true; }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool parseHex4(unsigned& out) {
+            if (pos + 4 > text.size()) return fail("truncated \\u escape");
+            out = 0;
+            for (int i = 0; i < 4; ++i) {
+                const char c = text[pos++];
+                out <<= 4;
+                if (c >= '0' && c <= '9') out |= c - '0';
+                else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+                else return fail("bad \\u escape");
+            }
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, unsigned cp) {
+            if (cp < 0x80) { out += static_cast<char>(cp); }
+            else if (cp < 0x800) { out += static_cast<char>(0xC0 | (cp >> 6)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+            else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12)); out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F)); out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (cp >> 18)); out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F)); out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool parseString(std::string& out) {
+            pos++; // '"'
+            while (pos < text.size()) {
+                const char c = text[pos++];
+                if (c == '"') return true;
+                if (static_cast<unsigned char>(c) < 0x20) return fail("control character in string");
+                if (c != '\\') { out += c; continue; }
+                if (pos >= text.size()) break;
+                const char e = text[pos++];
+                switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned cp;
+                    if (!parseHex4(cp)) return false;
+                    // Surrogate pair
+                    if (cp >= 0xD800 && cp < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                        pos += 2;
+                        unsigned low;
+                        if (!parseHex4(low)) return false;
+                        if (low < 0xDC00 || low >= 0xE000) return fail("bad surrogate pair");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: return fail("bad escape");
+                }
+            }
+            return fail("unterminated string");
+        }
+
+        bool parseNumber(JsonValue& out) {
+            const size_t start = pos;
+            if (text[pos] == '-') pos++;
+            while (pos < text.size() && ((text[pos] >= '0' && text[pos] <= '9') || text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-')) pos++;
+            const std::string token = text.substr(start, pos - start);
+            char* end = nullptr;
+            out.number = std::strtod(token.c_str(), &end);
+            if (end != token.c_str() + token.size()) { pos = start; return fail("bad number"); }
+            out.type = JsonValue::Type::Number;
+            return true;
+        }
+    };
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (type != Type::Object) return nullptr;
+    for (const auto& member : members) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+std::string JsonValue::scalarText() const {
+    switch (type) {
+    case Type::String: return text;
+    case Type::Bool: return boolean ? "true" : "false";
+    case Type::Number: { std::string out; appendJsonNumber(out, number); return out; }
+    default: return std::string();
+    }
+}
+
+bool parseJson(const std::string& text, JsonValue& out, std::string& error) {
+    Parser parser(text);
+    out = JsonValue();
+    bool ok = parser.parseValue(out, 0);
+    if (ok) {
+        parser.skipSpace();
+        if (parser.pos != text.size()) ok = parser.fail("trailing characters");
+    }
+    error = parser.error;
+    return ok;
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (const char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) { out += "\\u00"; out += hex[(c >> 4) & 0xF]; out += hex[c & 0xF]; }
+            else { out += c; }
+        }
+    }
+    out += '"';
+}
+
+void appendJsonNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) { out += "null"; return; }
+    if (std::floor(value) == value && std::fabs(value) < 1e15) { out += std::to_string(static_cast<long long>(value)); return; }
+    std::ostringstream text;
+    text.imbue(std::locale::classic());
+    text.precision(17);
+    text << value;
+    out += text.str();
+}
+
+void appendJsonBase64(std::string& out, const void* data, size_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    out.reserve(out.size() + (size + 2) / 3 * 4 + 2);
+    out += '"';
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        const std::uint32_t v = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+        out += alphabet[(v >> 18) & 63]; out += alphabet[(v >> 12) & 63]; out += alphabet[(v >> 6) & 63]; out += alphabet[v & 63];
+    }
+    if (i < size) {
+        const bool two = i + 1 < size;
+        const std::uint32_t v = (bytes[i] << 16) | (two ? bytes[i + 1] << 8 : 0);
+        out += alphabet[(v >> 18) & 63]; out += alphabet[(v >> 12) & 63]; out += two ? alphabet[(v >> 6) & 63] : '='; out += '=';
+    }
+    out += '"';
+}
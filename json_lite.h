@@ -0,0 +1,33 @@
+// Minimal JSON reader/writer helpers for the daemon's line-based request protocol
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;                             // Array elements
+    std::vector<std::pair<std::string, JsonValue>> members;   // Object members, in document order
+
+    // Member 'key' of an object, nullptr if absent or not an object
+    const JsonValue* find(const std::string& key) const;
+    // Scalar as text: strings as-is, numbers in round-trip form, bools as "true"/"false"
+    std::string scalarText() const;
+};
+
+// Parses one JSON document (trailing whitespace allowed). On failure 'error' describes the first problem.
+bool parseJson(const std::string& text, JsonValue& out, std::string& error);
+
+// Appends 'value' as a quoted, escaped JSON string
+void appendJsonString(std::string& out, const std::string& value);
+// Appends a number in round-trip form (integers without a fraction)
+void appendJsonNumber(std::string& out, double value);
+// Appends 'size' bytes as a quoted base64 JSON string, for payloads JSON cannot carry as text
+void appendJsonBase64(std::string& out, const void* data, size_t size);
@@ -7,6 +7,10 @@
 #include "imgui.h"
 #include "imgui-SFML.h"
 #include "tinyfiledialogs.h"
+#include "processing.h"
+#include "processing_worker.h"
+#include "profiler.h"
+#include "parameter_sweep.h"
 
 #include <iostream>
 #include <vector>
@@ -16,27 +20,44 @@
 #include <optional>
 #include <variant>
 #include <cstdint>
+#include <cstdio>
+#include <array>
+#include <atomic>
+#include <future>
+#include <chrono>
+
+// State of the "Parameter Sweep" window; the sweep itself runs on a std::async thread
+struct SweepUiState {
+    char cannyLow[64] = "20:100:40";
+    char cannyHigh[64] = "80:200:60";
+    char pixelSize[64] = "6,10,16";
+    char blurKernel[64] = "0,5";
+    std::future<SweepReport> pending;
+    std::atomic<bool> cancel{ false };
+    SweepReport report;
+    sf::Texture sheetTexture;
+    std::string status;
+};
+
+// Text of the "Generated Coordinates" panel, indexed into display rows once per generation so that a frame only lays out
+// the rows in view, however many coordinates there are
+struct CodeViewState {
+    static constexpr size_t maxRowChars = 256; // Longer lines (the bitset's base64 payload) are split over several rows
 
-// Helper struct for processing parameters
-struct ProcessingParams {
-    float scale = 0.5f;
-    int pixelSize = 10;
-    int brightness = 0;
-    float contrast = 1.0f;
-    bool applyBlur = false;
-    int blurKernel = 3;
-    int cannyLow = 50;
-    int cannyHigh = 100;
-    bool flipV = false;
-    bool flipH = false;
+    std::string text;
+    std::vector<size_t> rowStarts;  // Offset of every display row; a row ends where the next one starts, minus its newline
+    size_t widestRow = 0;           // Longest row, the only one measured to size the horizontal scroll range
 };
 
 // --- Function Prototypes ---
 bool loadImage(const std::string& filename, cv::Mat& outOriginalMat, sf::Texture& outOriginalTexture, sf::Image& outOriginalImage);
-void processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords);
-std::string generateCode(const std::vector<sf::Vector2i>& coords, const std::string& format);
 cv::Mat sfImageToCvMat(const sf::Image& image);
 void ApplyModernStyle();
+void DrawBlockGaps(const ImVec2& min, const ImVec2& max, sf::Vector2u blocks, int pixelSize);
+void SetCodeViewText(CodeViewState& view, std::string text);
+void DrawCodeView(const CodeViewState& view, float height);
+void DrawProfilerWindow(const std::array<float, 240>& frameTimesMs, size_t frameOffset);
+bool DrawSweepWindow(SweepUiState& sweep, const cv::Mat& originalMat, bool imageLoaded, ProcessingParams& params);
 
 
 // --- Main Application ---
@@ -57,32 +78,67 @@ int main() {
     // char inputImagePath[256] = "";
     std::string currentImagePath = "";
     cv::Mat originalMat;
-    cv::Mat pixelArtMat;
     sf::Texture originalTexture;
-    sf::Texture processedTexture;
+    sf::Texture processedTexture;   // One texel per block, drawn scaled up with the gaps masked in
+    int previewPixelSize = 2;
+    cv::Size previewProcessedSize;  // Raster size the preview texture stands for
+    int shownProxyFactor = 1;       // > 1 while the preview shows a quick downsampled run
+    bool fullPassPending = false;   // Last submit was a proxy run; the full-resolution pass is still owed
+    float processedPanelWidth = 800.0f;
+    sf::Clock idleClock;            // Time since the last parameter change
+    SweepUiState sweep;
     sf::Image originalImage;
     bool imageLoaded = false;
     bool needsProcessing = false;
     ProcessingParams params;
-    std::vector<sf::Vector2i> blockCoords;
-    std::string generatedCodeStr = "// Load an image and process...";
-    const char* outputFormats[] = { "C# List<(int x, int y)>", "JavaScript Array [[x, y], ...]", "Python List [(x, y), ...]" };
+    BlockGrid shownGrid;            // Blocks currently in processedTexture
+    ProcessingWorker processingWorker;
+    std::array<size_t, ProcessingCache::StageCount> cacheHits{}, cacheMisses{};
+    WorkspaceStats workspaceStats;
+    CodeViewState codeView;
+    SetCodeViewText(codeView, "// Load an image and process...");
+    const char* outputFormats[] = { "C# List<(int x, int y)>", "JavaScript Array [[x, y], ...]", "Python List [(x, y), ...]", "Base64 Bitset (JSON)" };
     int currentFormatIndex = 0;
     std::string codeFormatId = "csharp";
     sf::Clock deltaClock;
+    sf::Clock inputClock;           // Time since the last window event
+    std::array<float, 240> frameTimesMs{};
+    size_t frameOffset = 0;
+
+    Profiler::instance().setEnabled(true);
+    Profiler::instance().setThreadName("UI");
+
+    auto handleEvent = [&](const sf::Event& event) {
+        ImGui::SFML::ProcessEvent(window, event);
+        if (event.is<sf::Event::Closed>()) {
+            window.close();
+        }
+        inputClock.restart();
+    };
 
     // --- Main Loop ---
     while (window.isOpen()) {
         // --- Event Handling ---
+        // With no input for a moment and nothing being processed, block until the next event instead of redrawing the
+        // same frame 60 times a second. The grace period lets ImGui finish hover and tooltip changes after the last input.
+        sf::Time waited;
+        const bool workPending = needsProcessing || fullPassPending || processingWorker.busy() || processingWorker.hasResult()
+                              || sweep.pending.valid() || ImGui::GetIO().WantTextInput;
+        if (!workPending && inputClock.getElapsedTime() > sf::milliseconds(500)) {
+            sf::Clock waitClock;
+            if (const std::optional<sf::Event> event = window.waitEvent()) handleEvent(*event);
+            waited = waitClock.getElapsedTime();
+        }
         while (const std::optional<sf::Event> event = window.pollEvent()) {
-            ImGui::SFML::ProcessEvent(window, *event);
-            if (event->is<sf::Event::Closed>()) {
-                window.close();
-            }
+            handleEvent(*event);
         }
+        if (!window.isOpen()) break;
 
         // --- ImGui Frame Update ---
-        ImGui::SFML::Update(window, deltaClock.restart());
+        const sf::Time frameTime = deltaClock.restart();
+        frameTimesMs[frameOffset] = (frameTime - waited).asSeconds() * 1000.0f; // Time spent asleep is not frame time
+        frameOffset = (frameOffset + 1) % frameTimesMs.size();
+        ImGui::SFML::Update(window, frameTime);
 
         // --- GUI Layout (Using ImGui) ---
         ImGui::Begin("Controls");
@@ -107,15 +163,18 @@ int main() {
                 std::cout << "Selected image path: " << currentImagePath << std::endl;
 
                 if (loadImage(currentImagePath, originalMat, originalTexture, originalImage)) {
+                    processingWorker.setSource(originalMat);
+                    sweep.cancel = true; sweep.report = SweepReport(); sweep.sheetTexture = sf::Texture(); sweep.status.clear();
                     imageLoaded = true; needsProcessing = true;
-                    generatedCodeStr = "// Processing new image...";
-                    blockCoords.clear(); pixelArtMat = cv::Mat(); processedTexture = sf::Texture();
+                    SetCodeViewText(codeView, "// Processing new image...");
+                    shownGrid.reset(0, 0); processedTexture = sf::Texture();
                     std::cout << "Image loaded successfully." << std::endl;
                 }
                 else {
+                    processingWorker.setSource(cv::Mat());
                     imageLoaded = false; std::cerr << "Failed to load image: " << currentImagePath << std::endl;
-                    generatedCodeStr = "// Failed to load selected image";
-                    blockCoords.clear(); pixelArtMat = cv::Mat(); processedTexture = sf::Texture();
+                    SetCodeViewText(codeView, "// Failed to load selected image");
+                    shownGrid.reset(0, 0); processedTexture = sf::Texture();
                     tinyfd_messageBox("Error", "Failed to load the selected image file.", "ok", "error", 1); // Show error popup
                 }
             }
@@ -132,24 +191,32 @@ int main() {
         ImGui::Separator();
 
         bool changed = false;
+        bool dragging = false; // A slider is held this frame
         changed |= ImGui::SliderFloat("Input Scale", &params.scale, 0.1f, 2.0f, "%.2f");
+        dragging |= ImGui::IsItemActive();
         params.pixelSize = std::max(2, params.pixelSize);
         changed |= ImGui::SliderInt("Pixel Size", &params.pixelSize, 2, 50);
+        dragging |= ImGui::IsItemActive();
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Min 2px for spacing");
         changed |= ImGui::SliderInt("Brightness", &params.brightness, -100, 100);
+        dragging |= ImGui::IsItemActive();
         changed |= ImGui::SliderFloat("Contrast", &params.contrast, 0.5f, 3.0f, "%.1f");
+        dragging |= ImGui::IsItemActive();
         ImGui::Separator();
         changed |= ImGui::Checkbox("Apply Gaussian Blur", &params.applyBlur);
         if (params.applyBlur) {
             if (params.blurKernel < 1) params.blurKernel = 1;
             if (params.blurKernel % 2 == 0) params.blurKernel++;
             changed |= ImGui::SliderInt("Blur Kernel", &params.blurKernel, 1, 15);
+            dragging |= ImGui::IsItemActive();
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Must be odd");
         }
         ImGui::Separator();
         ImGui::Text("Canny Edge Thresholds");
         changed |= ImGui::SliderInt("Low##Canny", &params.cannyLow, 0, 250);
+        dragging |= ImGui::IsItemActive();
         changed |= ImGui::SliderInt("High##Canny", &params.cannyHigh, 0, 250);
+        dragging |= ImGui::IsItemActive();
         ImGui::Separator();
         changed |= ImGui::Checkbox("Flip Vertically", &params.flipV);
         changed |= ImGui::Checkbox("Flip Horizontally", &params.flipH);
@@ -158,64 +225,97 @@ int main() {
         if (ImGui::Combo("##Format", &currentFormatIndex, outputFormats, IM_ARRAYSIZE(outputFormats))) {
             if (currentFormatIndex == 0) codeFormatId = "csharp";
             else if (currentFormatIndex == 1) codeFormatId = "js";
-            else codeFormatId = "python";
-            if (imageLoaded && !blockCoords.empty()) {
-                generatedCodeStr = generateCode(blockCoords, codeFormatId);
-            }
+            else if (currentFormatIndex == 2) codeFormatId = "python";
+            else codeFormatId = "bitset";
+            // Every stage is a cache hit on the worker, so this only regenerates the code
+            if (imageLoaded) { needsProcessing = true; }
         }
         ImGui::Separator();
         if (ImGui::Button("Reset Settings")) {
             params = ProcessingParams(); currentFormatIndex = 0; codeFormatId = "csharp"; changed = true;
         }
         if (changed && imageLoaded) { needsProcessing = true; }
+        if (ImGui::CollapsingHeader("Stage Cache")) {
+            for (int stage = 0; stage < ProcessingCache::StageCount; ++stage) {
+                ImGui::Text("%-10s hits: %llu  misses: %llu", ProcessingCache::stageName(stage),
+                            static_cast<unsigned long long>(cacheHits[stage]), static_cast<unsigned long long>(cacheMisses[stage]));
+            }
+            ImGui::Separator();
+            ImGui::Text("Buffers: %.1f MB (peak %.1f MB)", workspaceStats.bytes / (1024.0 * 1024.0), workspaceStats.peakBytes / (1024.0 * 1024.0));
+            ImGui::Text("Reused: %llu  allocated: %llu", static_cast<unsigned long long>(workspaceStats.reuses), static_cast<unsigned long long>(workspaceStats.allocations));
+            if (ImGui::Button("Reset Counters")) { processingWorker.resetCacheCounters(); cacheHits.fill(0); cacheMisses.fill(0); }
+        }
         ImGui::End();
 
+        // Processing runs on the worker thread; the UI only hands over the latest params and uploads finished results.
+        // While a slider is dragged it asks for a quick run on a downsampled proxy sized for the preview panel; the
+        // full-resolution pass follows once the slider is released or held still for a moment.
+        if (changed) idleClock.restart();
+        const bool idle = idleClock.getElapsedTime() > sf::milliseconds(300);
         if (needsProcessing && imageLoaded) {
-            std::cout << "Processing image..." << std::endl;
             if (originalMat.empty()) {
                 std::cerr << "Error: Attempting to process an empty originalMat!" << std::endl;
-                generatedCodeStr = "// Error: Original image data missing";
-                needsProcessing = false;
+                SetCodeViewText(codeView, "// Error: Original image data missing");
             }
             else {
-                processImage(originalMat, pixelArtMat, params, blockCoords);
-
-                if (!pixelArtMat.empty()) {
-                    cv::Mat rgbaProcessedMat;
-                    cv::cvtColor(pixelArtMat, rgbaProcessedMat, cv::COLOR_GRAY2RGBA);
+                const bool proxyPass = dragging && !idle;
+                processingWorker.submit(params, codeFormatId, proxyPass ? static_cast<int>(processedPanelWidth) : 0);
+                fullPassPending = proxyPass;
+            }
+            needsProcessing = false;
+        }
+        else if (fullPassPending && (!dragging || idle)) {
+            processingWorker.submit(params, codeFormatId);
+            fullPassPending = false;
+        }
 
-                    if (rgbaProcessedMat.empty() || !rgbaProcessedMat.ptr()) {
-                        std::cerr << "Error: Failed to convert processed Mat to RGBA." << std::endl;
-                        generatedCodeStr = "// Error: RGBA conversion failed";
-                    }
-                    else {
-                        sf::Vector2u newSize = { static_cast<unsigned int>(rgbaProcessedMat.cols),
-                                                 static_cast<unsigned int>(rgbaProcessedMat.rows) };
-
-                        if (processedTexture.getSize() != newSize) {
-                            std::cout << "Resizing processed texture to " << newSize.x << "x" << newSize.y << std::endl;
-                            processedTexture = sf::Texture(newSize);
-                            if (processedTexture.getSize() != newSize) {
-                                std::cerr << "Failed to create/resize processed texture object." << std::endl;
-                                generatedCodeStr = "// Failed texture creation";
-                                goto skip_texture_update;
-                            }
-                        }
-
-                        processedTexture.update(static_cast<const std::uint8_t*>(rgbaProcessedMat.ptr()), newSize, { 0u, 0u });
-                        std::cout << "Processed texture updated." << std::endl;
-                        generatedCodeStr = generateCode(blockCoords, codeFormatId);
+        if (std::optional<ProcessingResult> result = processingWorker.takeResult()) {
+            cacheHits = result->cacheHits; cacheMisses = result->cacheMisses; workspaceStats = result->workspace;
+            if (result->ok) {
+                // Proxy results only carry the preview; the code waits for the full pass
+                previewPixelSize = result->pixelSize;
+                previewProcessedSize = result->processedSize;
+                shownProxyFactor = result->proxyFactor;
+                const cv::Mat& rgbaProcessedMat = result->previewRgba;
+                sf::Vector2u newSize = { static_cast<unsigned int>(rgbaProcessedMat.cols),
+                                         static_cast<unsigned int>(rgbaProcessedMat.rows) };
+
+                // Proxy and full results share the block grid, so only the block rows that changed since the texture was
+                // last written need uploading, and none at all if no block changed
+                BlockGridDiff changes = diffBlockGrids(shownGrid, result->blockGrid);
+                if (processedTexture.getSize() != newSize) {
+                    changes.resized = true;
+                    std::cout << "Resizing processed texture to " << newSize.x << "x" << newSize.y << std::endl;
+                    processedTexture = sf::Texture(newSize);
+                    processedTexture.setSmooth(false); // Nearest-neighbour, so blocks stay crisp when scaled up
+                    if (processedTexture.getSize() != newSize) {
+                        std::cerr << "Failed to create/resize processed texture object." << std::endl;
+                        SetCodeViewText(codeView, "// Failed texture creation");
+                        goto skip_texture_update;
                     }
-                skip_texture_update:;
                 }
-                else {
-                    std::cerr << "Processing failed, pixelArtMat is empty." << std::endl;
-                    generatedCodeStr = "// Processing failed";
-                    processedTexture = sf::Texture();
-                    blockCoords.clear();
+
+                // The preview stops at the last block row the raster draws, which may be short of the grid's last row
+                if (changes.resized) { changes.firstRow = 0; changes.lastRow = rgbaProcessedMat.rows - 1; }
+                changes.lastRow = std::min(changes.lastRow, rgbaProcessedMat.rows - 1);
+                if (changes.lastRow >= changes.firstRow) {
+                    ProfileScope scope("Texture upload");
+                    const unsigned rows = static_cast<unsigned>(changes.lastRow - changes.firstRow + 1);
+                    processedTexture.update(rgbaProcessedMat.ptr<std::uint8_t>(changes.firstRow), { newSize.x, rows }, { 0u, static_cast<unsigned>(changes.firstRow) });
+                    scope.setBytes(static_cast<size_t>(rows) * rgbaProcessedMat.step);
                 }
-                needsProcessing = false;
-                std::cout << "Processing finished." << std::endl;
+                shownGrid = std::move(result->blockGrid);
+                if (result->proxyFactor == 1) {
+                    SetCodeViewText(codeView, std::move(result->code));
+                    std::cout << "Processing finished in " << result->milliseconds << " ms." << std::endl;
+                }
+            skip_texture_update:;
+            }
+            else {
+                std::cerr << "Processing failed or was cancelled." << std::endl;
+                SetCodeViewText(codeView, "// Processing failed");
+                processedTexture = sf::Texture();
+                shownGrid.reset(0, 0);
             }
         }
 
@@ -237,8 +337,26 @@ int main() {
 
         ImGui::BeginChild("ProcessedPreview", ImVec2(0, previewHeight + 30), true);
         ImGui::Text("Processed (Pixelated Edges)");
+        processedPanelWidth = ImGui::GetContentRegionAvail().x;
         if (imageLoaded && processedTexture.getSize().x > 0) {
-            ImGui::Image(processedTexture, sf::Vector2f(ImGui::GetContentRegionAvail().x, previewHeight));
+            ImGui::SameLine();
+            if (shownProxyFactor > 1) { ImGui::TextColored(ImVec4(0.95f, 0.75f, 0.30f, 1.0f), "[preview 1/%d res]", shownProxyFactor); }
+            else { ImGui::TextDisabled("[full res]"); }
+        }
+        if (processingWorker.busy()) { ImGui::SameLine(); ImGui::TextDisabled("(updating...)"); }
+        if (imageLoaded && processedTexture.getSize().x > 0) {
+            // The panel stands for the whole raster. The texture only covers its drawn blocks, so it is scaled by the
+            // raster size and the strip past the last drawn block stays black, as in the saved output.
+            const ImVec2 areaMin = ImGui::GetCursorScreenPos();
+            const ImVec2 areaSize(ImGui::GetContentRegionAvail().x, previewHeight);
+            const sf::Vector2u blocks = processedTexture.getSize();
+            const float coveredX = std::min(1.0f, blocks.x * previewPixelSize / static_cast<float>(std::max(1, previewProcessedSize.width)));
+            const float coveredY = std::min(1.0f, blocks.y * previewPixelSize / static_cast<float>(std::max(1, previewProcessedSize.height)));
+            ImGui::GetWindowDrawList()->AddRectFilled(areaMin, ImVec2(areaMin.x + areaSize.x, areaMin.y + areaSize.y), IM_COL32(0, 0, 0, 255));
+            ImGui::Image(processedTexture, sf::Vector2f(areaSize.x * coveredX, areaSize.y * coveredY));
+            DrawBlockGaps(ImGui::GetItemRectMin(), ImGui::GetItemRectMax(), blocks, previewPixelSize);
+            ImGui::SetCursorScreenPos(areaMin);
+            ImGui::Dummy(areaSize);
         }
         else if (imageLoaded) { ImGui::TextDisabled("Processing..."); }
         else { ImGui::TextDisabled("No image loaded"); }
@@ -249,17 +367,16 @@ int main() {
         ImGui::Text("Generated Coordinates (Edge Pixels)");
         ImGui::SameLine(ImGui::GetWindowWidth() - 80);
         if (ImGui::Button("Copy Code")) {
-            if (!generatedCodeStr.empty()) { ImGui::SetClipboardText(generatedCodeStr.c_str()); }
-            else { ImGui::SetClipboardText(""); }
+            ImGui::SetClipboardText(codeView.text.c_str());
         }
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 1));
-        ImGui::BeginChild("CodeScroll", ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 10), true, ImGuiWindowFlags_HorizontalScrollbar);
-        ImGui::TextWrapped("%s", generatedCodeStr.empty() ? "// No code generated yet." : generatedCodeStr.c_str());
-        ImGui::EndChild();
+        DrawCodeView(codeView, ImGui::GetTextLineHeight() * 10);
         ImGui::PopStyleVar();
 
         ImGui::End();
 
+        DrawProfilerWindow(frameTimesMs, frameOffset);
+        if (DrawSweepWindow(sweep, originalMat, imageLoaded, params) && imageLoaded) { needsProcessing = true; }
 
         window.clear(sf::Color(17, 24, 39));
         ImGui::SFML::Render(window);
@@ -267,6 +384,8 @@ int main() {
     }
 
     // --- Cleanup ---
+    sweep.cancel = true;
+    if (sweep.pending.valid()) sweep.pending.wait();
     ImGui::SFML::Shutdown();
     return 0;
 }
@@ -278,8 +397,8 @@ cv::Mat sfImageToCvMat(const sf::Image& image) {
     if (size.x == 0 || size.y == 0) return cv::Mat();
     cv::Mat rgbaMat(size.y, size.x, CV_8UC4, const_cast<std::uint8_t*>(image.getPixelsPtr()));
     cv::Mat bgrMat;
-    cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR);
-    return bgrMat.clone();
+    cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR); // Writes a new buffer, so the result never aliases the sf::Image
+    return bgrMat;
 }
 
 // Loads image using SFML, updates texture, and converts to cv::Mat
@@ -297,77 +416,233 @@ bool loadImage(const std::string& filename, cv::Mat& outOriginalMat, sf::Texture
     return true;
 }
 
-// --- processImage function ---
-void processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords) {
-    if (originalMat.empty()) { std::cerr << "processImage: Input originalMat is empty." << std::endl; return; }
-    cv::Mat inputMat;
-    if (originalMat.channels() == 4) { cv::cvtColor(originalMat, inputMat, cv::COLOR_BGRA2BGR); }
-    else { originalMat.copyTo(inputMat); }
-
-    cv::Mat adjustedMat, grayMat, edgeMat;
-    outBlockCoords.clear();
-
-    // 1. Clone and apply scale
-    inputMat.copyTo(adjustedMat);
-    if (params.scale != 1.0f) {
-        cv::Size dsize(static_cast<int>(std::round(adjustedMat.cols * params.scale)), static_cast<int>(std::round(adjustedMat.rows * params.scale)));
-        int interp = params.scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
-        cv::resize(adjustedMat, adjustedMat, dsize, 0, 0, interp);
+// Masks the spacing pixelateEdges leaves around each block over the block-resolution preview.
+// A block covers pixelSize source pixels and is drawn max(1, pixelSize - 2) wide starting one pixel in.
+void DrawBlockGaps(const ImVec2& min, const ImVec2& max, sf::Vector2u blocks, int pixelSize) {
+    if (blocks.x == 0 || blocks.y == 0) return;
+    const float pixelW = (max.x - min.x) / (blocks.x * static_cast<float>(pixelSize));
+    const float pixelH = (max.y - min.y) / (blocks.y * static_cast<float>(pixelSize));
+    // Below a few screen pixels per block the gaps would just darken the whole preview
+    if (pixelW * pixelSize < 3.0f || pixelH * pixelSize < 3.0f) return;
+
+    // Gap around boundary k: the trailing spacing of block k-1 plus the leading pixel of block k
+    const float trailing = static_cast<float>(pixelSize - 1 - std::max(1, pixelSize - 2));
+    const ImU32 gapColor = IM_COL32(0, 0, 0, 255);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    for (unsigned k = 0; k <= blocks.x; ++k) {
+        const float x0 = std::max(min.x, min.x + (k * pixelSize - trailing) * pixelW);
+        const float x1 = std::min(max.x, min.x + (k * pixelSize + 1) * pixelW);
+        drawList->AddRectFilled(ImVec2(x0, min.y), ImVec2(x1, max.y), gapColor);
     }
-    // 2. Brightness/contrast
-    if (params.contrast != 1.0f || params.brightness != 0) { adjustedMat.convertTo(adjustedMat, -1, params.contrast, params.brightness); }
-    // 3. Blur
-    if (params.applyBlur && params.blurKernel > 1) { cv::GaussianBlur(adjustedMat, adjustedMat, { params.blurKernel, params.blurKernel }, 0, 0, cv::BORDER_DEFAULT); }
-    // 4. Flip
-    int flipCode = -2; if (params.flipV && params.flipH) flipCode = -1; else if (params.flipV) flipCode = 0; else if (params.flipH) flipCode = 1; if (flipCode > -2) { cv::flip(adjustedMat, adjustedMat, flipCode); }
-    // 5. Grayscale
-    if (adjustedMat.channels() == 3) { cv::cvtColor(adjustedMat, grayMat, cv::COLOR_BGR2GRAY); }
-    else if (adjustedMat.channels() == 4) { cv::cvtColor(adjustedMat, grayMat, cv::COLOR_BGRA2GRAY); }
-    else if (adjustedMat.channels() == 1) { grayMat = adjustedMat; }
-    else { std::cerr << "Unsupported channels for grayscale: " << adjustedMat.channels() << std::endl; return; }
-    // 6. Canny
-    cv::Canny(grayMat, edgeMat, params.cannyLow, params.cannyHigh, 3, false);
-    // 7. Create output mat
-    outPixelArtMat = cv::Mat::zeros(edgeMat.size(), CV_8UC1);
-    const int pixelSize = std::max(2, params.pixelSize); const int spacing = 1;
-
-    const int drawW_fixed = std::max(1, pixelSize - 2 * spacing);
-    const int drawH_fixed = std::max(1, pixelSize - 2 * spacing);
-
-    // 8. Pixelation Loop
-    for (int y = 0; y < edgeMat.rows; y += pixelSize) {
-        for (int x = 0; x < edgeMat.cols; x += pixelSize) {
-            int blockW = std::min(pixelSize, edgeMat.cols - x); int blockH = std::min(pixelSize, edgeMat.rows - y); if (blockW <= 0 || blockH <= 0) continue;
-            cv::Mat roiEdge = edgeMat({ x, y, blockW, blockH });
-            if (cv::mean(roiEdge)[0] > 0) {
-                outBlockCoords.push_back({ x / pixelSize, y / pixelSize });
-                int drawX = x + spacing; int drawY = y + spacing;
-                if ((drawX + drawW_fixed <= outPixelArtMat.cols) && (drawY + drawH_fixed <= outPixelArtMat.rows)) {
-                    cv::rectangle(outPixelArtMat, { drawX, drawY, drawW_fixed, drawH_fixed }, cv::Scalar(255), cv::FILLED);
-                }
-                else if (blockW == 1 && blockH == 1) { cv::rectangle(outPixelArtMat, { x, y, 1, 1 }, cv::Scalar(255), cv::FILLED); }
+    for (unsigned k = 0; k <= blocks.y; ++k) {
+        const float y0 = std::max(min.y, min.y + (k * pixelSize - trailing) * pixelH);
+        const float y1 = std::min(max.y, min.y + (k * pixelSize + 1) * pixelH);
+        drawList->AddRectFilled(ImVec2(min.x, y0), ImVec2(max.x, y1), gapColor);
+    }
+}
+
+void SetCodeViewText(CodeViewState& view, std::string text) {
+    ProfileScope scope("Code view index");
+    view.text = std::move(text);
+    view.rowStarts.clear();
+    view.widestRow = 0;
+    size_t widest = 0;
+    const size_t size = view.text.size();
+    size_t pos = 0;
+    do {
+        const size_t newline = view.text.find('\n', pos);
+        const size_t lineEnd = newline == std::string::npos ? size : newline;
+        do {
+            const size_t rowEnd = std::min(lineEnd, pos + CodeViewState::maxRowChars);
+            if (rowEnd - pos > widest) { widest = rowEnd - pos; view.widestRow = view.rowStarts.size(); }
+            view.rowStarts.push_back(pos);
+            pos = rowEnd;
+        } while (pos < lineEnd);
+        pos = lineEnd + 1;
+    } while (pos < size);
+}
+
+// Replaces a TextWrapped of the whole string, which laid out every line on every frame
+void DrawCodeView(const CodeViewState& view, float height) {
+    const char* text = view.text.c_str();
+    auto rowEnd = [&](size_t row) {
+        size_t end = row + 1 < view.rowStarts.size() ? view.rowStarts[row + 1] : view.text.size();
+        if (end > view.rowStarts[row] && text[end - 1] == '\n') end--;
+        return text + end;
+    };
+
+    // Rows outside the clipper's range are never measured, so the scroll width comes from the widest row instead
+    const size_t widest = view.widestRow;
+    ImGui::SetNextWindowContentSize(ImVec2(ImGui::CalcTextSize(text + view.rowStarts[widest], rowEnd(widest)).x, 0.0f));
+    ImGui::BeginChild("CodeScroll", ImVec2(-FLT_MIN, height), true, ImGuiWindowFlags_HorizontalScrollbar);
+    if (view.text.empty()) { ImGui::TextDisabled("// No code generated yet."); }
+    else {
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(view.rowStarts.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                ImGui::TextUnformatted(text + view.rowStarts[row], rowEnd(row));
             }
         }
+        clipper.End();
     }
+    ImGui::EndChild();
 }
 
-std::string generateCode(const std::vector<sf::Vector2i>& coords, const std::string& format) {
-    if (coords.empty()) { return "// No edge blocks detected."; }
-    std::string output = "", lineEnding = ",\n";
-    if (format == "csharp") {
-        output += "private static readonly List<(int x, int y)> edgePixels = new List<(int x, int y)>\n{\n";
-        for (size_t i = 0; i < coords.size(); ++i) { output += "    (" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + ")"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "};";
+// Sweep ranges, contact sheet and results table. Returns true when a row's settings were applied to 'params'.
+bool DrawSweepWindow(SweepUiState& sweep, const cv::Mat& originalMat, bool imageLoaded, ProcessingParams& params) {
+    bool applied = false;
+    const bool running = sweep.pending.valid();
+    if (running && sweep.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        const bool wasCancelled = sweep.cancel;
+        sweep.report = sweep.pending.get();
+        if (sweep.report.results.empty()) { sweep.status = wasCancelled ? "Sweep cancelled." : "Sweep failed, see console."; }
+        else {
+            cv::Mat sheet, sheetRgba;
+            sheet = buildContactSheet(sweep.report.results, 200, 4);
+            cv::cvtColor(sheet, sheetRgba, cv::COLOR_GRAY2RGBA);
+            const sf::Vector2u size = { static_cast<unsigned int>(sheetRgba.cols), static_cast<unsigned int>(sheetRgba.rows) };
+            sweep.sheetTexture = sf::Texture(size);
+            sweep.sheetTexture.update(static_cast<const std::uint8_t*>(sheetRgba.ptr()), size, { 0u, 0u });
+            char text[160];
+            std::snprintf(text, sizeof(text), "%zu combinations in %.0f ms (%zu upstream chains, %zu Canny runs)",
+                          sweep.report.results.size(), sweep.report.totalMs, sweep.report.upstreamRuns, sweep.report.cannyRuns);
+            sweep.status = text;
+        }
     }
-    else if (format == "js") {
-        output += "const edgePixels = [\n";
-        for (size_t i = 0; i < coords.size(); ++i) { output += "  [" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + "]"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "];";
+
+    ImGui::Begin("Parameter Sweep");
+    ImGui::TextDisabled("first:last:step or a,b,c; other settings come from Controls");
+    ImGui::InputText("Canny Low", sweep.cannyLow, sizeof(sweep.cannyLow));
+    ImGui::InputText("Canny High", sweep.cannyHigh, sizeof(sweep.cannyHigh));
+    ImGui::InputText("Pixel Size##Sweep", sweep.pixelSize, sizeof(sweep.pixelSize));
+    ImGui::InputText("Blur Kernel##Sweep", sweep.blurKernel, sizeof(sweep.blurKernel));
+
+    if (sweep.pending.valid()) {
+        ImGui::TextDisabled("Running...");
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) sweep.cancel = true;
+    }
+    else {
+        ImGui::BeginDisabled(!imageLoaded);
+        if (ImGui::Button("Run Sweep")) {
+            SweepSpec spec;
+            spec.base = params;
+            if (!parseSweepValues(sweep.cannyLow, spec.cannyLow) || !parseSweepValues(sweep.cannyHigh, spec.cannyHigh)
+                || !parseSweepValues(sweep.pixelSize, spec.pixelSize) || !parseSweepValues(sweep.blurKernel, spec.blurKernel)) {
+                sweep.status = "Invalid range.";
+            }
+            else {
+                sweep.cancel = false;
+                sweep.status.clear();
+                sweep.pending = std::async(std::launch::async, [source = originalMat, spec, &sweep] {
+                    SweepReport report;
+                    runParameterSweep(source, spec, report, &sweep.cancel);
+                    return report;
+                });
+            }
+        }
+        ImGui::EndDisabled();
     }
-    else if (format == "python") {
-        output += "edge_pixels = [\n";
-        for (size_t i = 0; i < coords.size(); ++i) { output += "    (" + std::to_string(coords[i].x) + ", " + std::to_string(coords[i].y) + ")"; output += (i == coords.size() - 1) ? "\n" : lineEnding; } output += "]";
+    if (!sweep.status.empty()) { ImGui::SameLine(); ImGui::TextUnformatted(sweep.status.c_str()); }
+
+    if (!sweep.report.results.empty()) {
+        ImGui::Separator();
+        const sf::Vector2u sheetSize = sweep.sheetTexture.getSize();
+        if (sheetSize.x > 0) {
+            const float width = std::min(ImGui::GetContentRegionAvail().x, static_cast<float>(sheetSize.x));
+            ImGui::Image(sweep.sheetTexture, sf::Vector2f(width, width * sheetSize.y / sheetSize.x));
+        }
+        if (ImGui::BeginTable("SweepResults", 7, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerH | ImGuiTableFlags_ScrollY, ImVec2(0, 240))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Low");
+            ImGui::TableSetupColumn("High");
+            ImGui::TableSetupColumn("Pixel");
+            ImGui::TableSetupColumn("Blur");
+            ImGui::TableSetupColumn("Blocks");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableSetupColumn("");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < sweep.report.results.size(); ++i) {
+                const SweepResult& r = sweep.report.results[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%d", r.params.cannyLow);
+                ImGui::TableNextColumn(); ImGui::Text("%d", r.params.cannyHigh);
+                ImGui::TableNextColumn(); ImGui::Text("%d", r.params.pixelSize);
+                ImGui::TableNextColumn(); ImGui::Text("%d", r.params.applyBlur ? r.params.blurKernel : 0);
+                ImGui::TableNextColumn(); ImGui::Text("%zu", r.blockCount);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f", r.cannyMs + r.pixelateMs);
+                ImGui::TableNextColumn();
+                ImGui::PushID(static_cast<int>(i));
+                if (ImGui::SmallButton("Apply")) {
+                    params.cannyLow = r.params.cannyLow; params.cannyHigh = r.params.cannyHigh; params.pixelSize = r.params.pixelSize;
+                    params.applyBlur = r.params.applyBlur; params.blurKernel = r.params.blurKernel;
+                    applied = true;
+                }
+                ImGui::PopID();
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+    return applied;
+}
+
+// Per-stage timings from the profiler ring buffer, UI frame times and Chrome trace export
+void DrawProfilerWindow(const std::array<float, 240>& frameTimesMs, size_t frameOffset) {
+    Profiler& profiler = Profiler::instance();
+    ImGui::Begin("Profiler");
+
+    float frameAverage = 0.0f;
+    for (float ms : frameTimesMs) frameAverage += ms;
+    frameAverage /= frameTimesMs.size();
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "avg %.2f ms", frameAverage);
+    ImGui::Text("Frame time");
+    ImGui::PlotLines("##FrameTimes", frameTimesMs.data(), static_cast<int>(frameTimesMs.size()), static_cast<int>(frameOffset),
+                     overlay, 0.0f, 50.0f, ImVec2(-FLT_MIN, 50));
+    ImGui::Separator();
+
+    const std::vector<ProfileSummary> summaries = profiler.summarize(64);
+    if (summaries.empty()) { ImGui::TextDisabled("No stages recorded yet."); }
+    if (ImGui::BeginTable("Stages", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerH | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableSetupColumn("Alloc KB");
+        ImGui::TableSetupColumn("Recent runs", ImGuiTableColumnFlags_WidthStretch, 3.0f);
+        ImGui::TableHeadersRow();
+        for (const ProfileSummary& summary : summaries) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(summary.name);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", summary.averageMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", summary.maxMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.0f", summary.averageBytes / 1024.0);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Last run: %.0f KB", summary.lastBytes / 1024.0);
+            ImGui::TableNextColumn();
+            ImGui::PushID(summary.name);
+            ImGui::PlotHistogram("##History", summary.recentMs.data(), static_cast<int>(summary.recentMs.size()), 0, nullptr,
+                                 0.0f, static_cast<float>(summary.maxMs), ImVec2(-FLT_MIN, 24));
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Separator();
+
+    bool enabled = profiler.enabled();
+    if (ImGui::Checkbox("Record", &enabled)) profiler.setEnabled(enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) profiler.clear();
+    ImGui::SameLine();
+    if (ImGui::Button("Export Trace...")) {
+        char const* filterPatterns[1] = { "*.json" };
+        char const* savePath = tinyfd_saveFileDialog("Export Chrome Trace", "edgepixel_trace.json", 1, filterPatterns, "Chrome Trace JSON");
+        if (savePath != NULL) {
+            if (profiler.writeChromeTrace(savePath)) { std::cout << "Trace written to " << savePath << std::endl; }
+            else { tinyfd_messageBox("Error", "Failed to write the trace file.", "ok", "error", 1); }
+        }
     }
-    else { output = "// Unknown format selected"; }
-    return output;
+    ImGui::End();
 }
 
 void ApplyModernStyle() {
@@ -0,0 +1,183 @@
+#include "parameter_sweep.h"
+#include "block_kernel.h"
+#include "preprocess_kernel.h"
+#include "thread_pool.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double msSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool cancelled(const std::atomic<bool>* cancel) {
+        return cancel && cancel->load(std::memory_order_relaxed);
+    }
+}
+
+bool parseSweepValues(const std::string& text, std::vector<int>& outValues) {
+    outValues.clear();
+    try {
+        const size_t colon = text.find(':');
+        if (colon != std::string::npos) {
+            const size_t colon2 = text.find(':', colon + 1);
+            const int first = std::stoi(text.substr(0, colon));
+            const int last = std::stoi(text.substr(colon + 1, colon2 == std::string::npos ? std::string::npos : colon2 - colon - 1));
+            const int step = colon2 == std::string::npos ? 1 : std::stoi(text.substr(colon2 + 1));
+            if (step <= 0 || last < first) return false;
+            for (int v = first; v <= last; v += step) outValues.push_back(v);
+        }
+        else {
+            std::stringstream list(text);
+            for (std::string item; std::getline(list, item, ',');) {
+                if (item.find_first_not_of(" \t") == std::string::npos) continue;
+                outValues.push_back(std::stoi(item));
+            }
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return !outValues.empty();
+}
+
+std::string sweepLabel(const ProcessingParams& params) {
+    std::ostringstream label;
+    label << "low=" << params.cannyLow << " high=" << params.cannyHigh << " px=" << params.pixelSize
+          << " blur=" << (params.applyBlur && params.blurKernel > 1 ? params.blurKernel : 0);
+    return label.str();
+}
+
+bool runParameterSweep(const cv::Mat& originalMat, const SweepSpec& spec, SweepReport& outReport, const std::atomic<bool>* cancel) {
+    using Cache = ProcessingCache;
+    outReport = SweepReport();
+    if (originalMat.empty()) { std::cerr << "runParameterSweep: Input originalMat is empty." << std::endl; return false; }
+
+    const ProcessingParams& base = spec.base;
+    auto valuesOr = [](const std::vector<int>& values, int fallback) { return values.empty() ? std::vector<int>{ fallback } : values; };
+    const std::vector<int> lows = valuesOr(spec.cannyLow, base.cannyLow);
+    const std::vector<int> highs = valuesOr(spec.cannyHigh, base.cannyHigh);
+    std::vector<int> pixelSizes = valuesOr(spec.pixelSize, base.pixelSize);
+    std::vector<int> blurs = valuesOr(spec.blurKernel, base.applyBlur ? base.blurKernel : 0);
+    for (int& ps : pixelSizes) ps = std::max(2, ps);
+    for (int& kernel : blurs) kernel = kernel <= 1 ? 0 : (kernel % 2 == 0 ? kernel + 1 : kernel);
+    std::sort(blurs.begin(), blurs.end());
+    blurs.erase(std::unique(blurs.begin(), blurs.end()), blurs.end());
+
+    struct CannyJob { size_t blur; int low, high; size_t firstResult; };
+    std::vector<CannyJob> cannyJobs;
+    for (size_t b = 0; b < blurs.size(); ++b) {
+        for (int low : lows) {
+            for (int high : highs) {
+                if (low > high) continue; // Canny swaps them, so these would repeat the mirrored combination
+                cannyJobs.push_back({ b, low, high, cannyJobs.size() * pixelSizes.size() });
+            }
+        }
+    }
+    const size_t combinations = cannyJobs.size() * pixelSizes.size();
+    if (combinations == 0) { std::cerr << "runParameterSweep: no combination has cannyLow <= cannyHigh." << std::endl; return false; }
+    if (combinations > spec.maxCombinations) {
+        std::cerr << "runParameterSweep: " << combinations << " combinations exceed the limit of " << spec.maxCombinations << "." << std::endl;
+        return false;
+    }
+
+    const auto start = Clock::now();
+
+    // 1. Scale is the same for every combination
+    cv::Mat scaled;
+    if (!runPipelineStage(Cache::StageScale, originalMat, scaled, base)) return false;
+
+    ThreadPool pool(spec.threads);
+    std::atomic<bool> failed{ false };
+
+    // 2.-5. One fused adjust/flip/grayscale/blur pass per distinct blur setting, as in processImage
+    std::vector<cv::Mat> grays(blurs.size());
+    for (size_t b = 0; b < blurs.size(); ++b) {
+        pool.submit([&, b] {
+            if (failed || cancelled(cancel)) return;
+            ProcessingParams p = base;
+            p.applyBlur = blurs[b] > 1;
+            p.blurKernel = std::max(1, blurs[b]);
+            if (!preprocessFused(scaled, grays[b], p)) failed = true;
+        });
+    }
+    pool.wait();
+    outReport.sharedMs = msSince(start);
+    outReport.upstreamRuns = blurs.size();
+    if (failed || cancelled(cancel)) return false;
+
+    // 6./7. Fan out Canny per (blur, low, high) and pixelation per pixel size
+    outReport.results.resize(combinations);
+    for (const CannyJob& job : cannyJobs) {
+        pool.submit([&, job] {
+            if (failed || cancelled(cancel)) return;
+            ProcessingParams p = base;
+            p.applyBlur = blurs[job.blur] > 1;
+            p.blurKernel = std::max(1, blurs[job.blur]);
+            p.cannyLow = job.low;
+            p.cannyHigh = job.high;
+
+            const auto cannyStart = Clock::now();
+            cv::Mat edges;
+            if (!runPipelineStage(Cache::StageCanny, grays[job.blur], edges, p)) { failed = true; return; }
+            const double cannyMs = msSince(cannyStart);
+
+            cv::Mat pixelArt;
+            std::vector<sf::Vector2i> coords;
+            for (size_t i = 0; i < pixelSizes.size(); ++i) {
+                SweepResult& result = outReport.results[job.firstResult + i];
+                result.params = p;
+                result.params.pixelSize = pixelSizes[i];
+                const auto pixelateStart = Clock::now();
+                pixelateEdges(edges, pixelSizes[i], pixelArt, coords);
+                result.blockMask = blockMaskFromCoords(coords, edges.size(), pixelSizes[i]);
+                result.pixelateMs = msSince(pixelateStart);
+                result.cannyMs = cannyMs;
+                result.blockCount = coords.size();
+            }
+        });
+    }
+    pool.wait();
+    outReport.cannyRuns = cannyJobs.size();
+    outReport.totalMs = msSince(start);
+    if (failed || cancelled(cancel)) { outReport.results.clear(); return false; }
+    return true;
+}
+
+cv::Mat buildContactSheet(const std::vector<SweepResult>& results, int cellWidth, int columns) {
+    if (results.empty() || cellWidth <= 0 || columns <= 0) return cv::Mat();
+
+    // Every mask covers the same processed image, so one aspect ratio fits all cells
+    const cv::Mat& first = results.front().blockMask;
+    const double aspect = first.cols > 0 ? static_cast<double>(first.rows) / first.cols : 1.0;
+    const int imageHeight = std::max(1, static_cast<int>(std::round(cellWidth * aspect)));
+    const int captionHeight = 34, margin = 4;
+    const int cellHeight = imageHeight + captionHeight;
+    const int rows = static_cast<int>((results.size() + columns - 1) / columns);
+    const int sheetColumns = std::min<int>(columns, static_cast<int>(results.size()));
+
+    cv::Mat sheet(rows * (cellHeight + margin) + margin, sheetColumns * (cellWidth + margin) + margin, CV_8UC1, cv::Scalar(40));
+    for (size_t i = 0; i < results.size(); ++i) {
+        const int x = margin + static_cast<int>(i % columns) * (cellWidth + margin);
+        const int y = margin + static_cast<int>(i / columns) * (cellHeight + margin);
+        if (!results[i].blockMask.empty()) {
+            cv::Mat cell = sheet({ x, y, cellWidth, imageHeight });
+            cv::resize(results[i].blockMask, cell, cell.size(), 0, 0, cv::INTER_NEAREST);
+        }
+        const ProcessingParams& p = results[i].params;
+        const std::string line1 = "L" + std::to_string(p.cannyLow) + " H" + std::to_string(p.cannyHigh) + " P" + std::to_string(p.pixelSize)
+                                + " B" + std::to_string(p.applyBlur && p.blurKernel > 1 ? p.blurKernel : 0);
+        const std::string line2 = std::to_string(results[i].blockCount) + " blocks";
+        cv::putText(sheet, line1, { x + 2, y + imageHeight + 14 }, cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(230), 1, cv::LINE_AA);
+        cv::putText(sheet, line2, { x + 2, y + imageHeight + 29 }, cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(170), 1, cv::LINE_AA);
+    }
+    return sheet;
+}
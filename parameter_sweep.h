@@ -0,0 +1,51 @@
+// Parameter sweep: evaluates a grid of Canny/pixel size/blur settings in parallel, sharing the upstream stages
+
+#pragma once
+
+#include "processing.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Values to try for each swept field; an empty list keeps the value from 'base'
+struct SweepSpec {
+    ProcessingParams base;
+    std::vector<int> cannyLow;
+    std::vector<int> cannyHigh;
+    std::vector<int> pixelSize;
+    std::vector<int> blurKernel;   // 0 or 1 = no blur, otherwise an odd kernel size
+    unsigned threads = 0;          // 0 = hardware threads
+    size_t maxCombinations = 512;
+};
+
+struct SweepResult {
+    ProcessingParams params;
+    size_t blockCount = 0;
+    cv::Mat blockMask;             // One pixel per block (CV_8UC1, 255 = lit)
+    double cannyMs = 0.0;          // Shared by every pixel size of the same Canny settings
+    double pixelateMs = 0.0;
+};
+
+struct SweepReport {
+    std::vector<SweepResult> results;   // Ordered by blur, cannyLow, cannyHigh, pixelSize
+    double sharedMs = 0.0;              // Scale + brightness/contrast, and one blur/flip/grayscale chain per blur setting
+    double totalMs = 0.0;
+    size_t upstreamRuns = 0;            // Blur/flip/grayscale chains actually computed
+    size_t cannyRuns = 0;
+};
+
+// Parses "20:100:20" (first:last:step), "20:100" (step 1), "3,5,7" or a single value
+bool parseSweepValues(const std::string& text, std::vector<int>& outValues);
+
+// Scale and brightness/contrast run once, blur/flip/grayscale once per distinct blur setting, and only Canny
+// (per blur x low x high, skipping low > high) and pixelation (per pixel size) fan out on a ThreadPool.
+// Returns false if the source is empty, the grid exceeds maxCombinations, a stage fails or 'cancel' is raised.
+bool runParameterSweep(const cv::Mat& originalMat, const SweepSpec& spec, SweepReport& outReport, const std::atomic<bool>* cancel = nullptr);
+
+// Grid of the block masks, 'columns' per row, each scaled to 'cellWidth' and captioned with its settings and block count
+cv::Mat buildContactSheet(const std::vector<SweepResult>& results, int cellWidth, int columns);
+// "low=20 high=100 px=10 blur=5"
+std::string sweepLabel(const ProcessingParams& params);
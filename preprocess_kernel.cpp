@@ -0,0 +1,108 @@
+#include "preprocess_kernel.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+    // About one L2-sized slice of the source per task
+    const double stripePixels = 65536.0;
+
+    // Brightness/contrast result for every input value, built with convertTo itself so rounding and saturation are
+    // the Adjust stage's own
+    std::array<std::uint8_t, 256> adjustTable(const ProcessingParams& params) {
+        cv::Mat identity(1, 256, CV_8UC1), adjusted;
+        for (int i = 0; i < 256; ++i) identity.at<std::uint8_t>(0, i) = static_cast<std::uint8_t>(i);
+        identity.convertTo(adjusted, -1, params.contrast, params.brightness);
+
+        std::array<std::uint8_t, 256> table;
+        for (int i = 0; i < 256; ++i) table[i] = adjusted.at<std::uint8_t>(0, i);
+        return table;
+    }
+
+    // One output row from its (already vertically remapped) source row, every channel adjusted and mirrored as requested
+    template <int Channels, bool FlipH, bool Adjust>
+    void remapRow(const std::uint8_t* src, std::uint8_t* dst, int cols, const std::uint8_t* table) {
+        for (int x = 0; x < cols; ++x) {
+            const std::uint8_t* p = src + (FlipH ? cols - 1 - x : x) * Channels;
+            std::uint8_t* q = dst + x * Channels;
+            for (int c = 0; c < Channels; ++c) q[c] = Adjust ? table[p[c]] : p[c];
+        }
+    }
+
+    using RowKernel = void (*)(const std::uint8_t*, std::uint8_t*, int, const std::uint8_t*);
+
+    template <int Channels>
+    RowKernel selectRowKernel(bool flipH, bool adjust) {
+        if (flipH) return adjust ? &remapRow<Channels, true, true> : &remapRow<Channels, true, false>;
+        return adjust ? &remapRow<Channels, false, true> : &remapRow<Channels, false, false>;
+    }
+
+    RowKernel rowKernel(int channels, bool flipH, bool adjust) {
+        switch (channels) {
+        case 1: return selectRowKernel<1>(flipH, adjust);
+        case 3: return selectRowKernel<3>(flipH, adjust);
+        default: return selectRowKernel<4>(flipH, adjust);
+        }
+    }
+}
+
+bool preprocessFused(const cv::Mat& scaledMat, cv::Mat& outGray, const ProcessingParams& params, ProcessingContext* workspace) {
+    if (scaledMat.empty() || scaledMat.depth() != CV_8U) { std::cerr << "preprocessFused: expected a non-empty 8-bit image." << std::endl; return false; }
+    const int channels = scaledMat.channels();
+    if (channels != 1 && channels != 3 && channels != 4) { std::cerr << "Unsupported channels for grayscale: " << channels << std::endl; return false; }
+    auto buffer = [workspace](cv::Size size, int type) { return workspace ? workspace->acquire(size, type) : cv::Mat(size, type); };
+
+    const bool adjust = params.contrast != 1.0f || params.brightness != 0;
+    const bool blur = params.applyBlur && params.blurKernel > 1;
+    const std::array<std::uint8_t, 256> table = adjust ? adjustTable(params) : std::array<std::uint8_t, 256>{};
+    const int rows = scaledMat.rows, cols = scaledMat.cols;
+    const double stripes = std::max(1.0, static_cast<double>(rows) * cols / stripePixels);
+
+    // 1. Blur, like the staged path, on the adjusted colour image. The adjustment then needs a pass of its own;
+    // without blur it is folded into the flip pass below.
+    cv::Mat source = scaledMat;
+    if (blur) {
+        cv::Mat adjusted = scaledMat;
+        if (adjust) {
+            adjusted = buffer(scaledMat.size(), scaledMat.type());
+            const RowKernel kernel = rowKernel(channels, false, true);
+            cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; ++y) kernel(scaledMat.ptr<std::uint8_t>(y), adjusted.ptr<std::uint8_t>(y), cols, table.data());
+            }, stripes);
+        }
+        source = buffer(scaledMat.size(), scaledMat.type());
+        cv::GaussianBlur(adjusted, source, { params.blurKernel, params.blurKernel }, 0, 0, cv::BORDER_DEFAULT);
+    }
+
+    // 2. Adjust + flip, one read of the source per row. Colour rows are converted by cvtColor a stripe at a time while
+    // still in cache, so the gray mix is OpenCV's own (its rounding differs between versions and IPP builds).
+    const bool adjustRows = adjust && !blur;
+    const bool remap = adjustRows || params.flipH || params.flipV;
+    if (!remap && channels == 1) { outGray = source; return true; }
+    const int grayCode = channels == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY;
+    cv::Mat gray = buffer(scaledMat.size(), CV_8UC1);
+    if (!remap) {
+        cv::cvtColor(source, gray, grayCode);
+        outGray = gray;
+        return true;
+    }
+
+    const RowKernel kernel = rowKernel(channels, params.flipH, adjustRows);
+    cv::Mat remapped = channels == 1 ? gray : buffer(scaledMat.size(), scaledMat.type());
+    const bool flipV = params.flipV;
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            kernel(source.ptr<std::uint8_t>(flipV ? rows - 1 - y : y), remapped.ptr<std::uint8_t>(y), cols, table.data());
+        }
+        if (channels != 1) {
+            cv::Mat grayRows = gray.rowRange(range);
+            cv::cvtColor(remapped.rowRange(range), grayRows, grayCode);
+        }
+    }, stripes);
+    outGray = gray;
+    return true;
+}
@@ -0,0 +1,15 @@
+// Fused preprocessing kernel: brightness/contrast, flip and grayscale of processImage in one pass
+
+#pragma once
+
+#include "processing.h"
+
+#include <opencv2/core.hpp>
+
+// Runs stages Adjust..Gray on the output of the Scale stage (8-bit gray, BGR or BGRA) and writes the CV_8UC1 image Canny
+// reads. Every output pixel reads its flipped source pixel with the adjusted channel values from a lookup table, and is
+// converted to gray by cv::cvtColor one row stripe at a time, with the stripes spread over OpenCV's thread pool. The row
+// kernel is instantiated per channel count, horizontal flip and identity contrast, so switched-off steps cost nothing;
+// the vertical flip is only a row remap. With blur enabled, the adjusted colour image is blurred first, as in the staged
+// order. The result is identical to runPipelineStage over StageAdjust..StageGray.
+bool preprocessFused(const cv::Mat& scaledMat, cv::Mat& outGray, const ProcessingParams& params, ProcessingContext* workspace = nullptr);
@@ -0,0 +1,343 @@
+#include "processing.h"
+#include "block_kernel.h"
+#include "preprocess_kernel.h"
+#include "profiler.h"
+#include "coord_serializer.h"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+// --- processImage function ---
+bool processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords) {
+    ProcessingCache scratch;
+    return processImage(originalMat, outPixelArtMat, params, outBlockCoords, scratch);
+}
+
+bool processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords, ProcessingCache& cache, const std::atomic<bool>* cancel) {
+    using Cache = ProcessingCache;
+    if (originalMat.empty()) { std::cerr << "processImage: Input originalMat is empty." << std::endl; return false; }
+    outBlockCoords.clear();
+
+    // 1.-6. Scale, brightness/contrast, blur, flip, grayscale, Canny
+    bool upstream = false;
+    if (!cache.runImageStages(originalMat, params, cancel, upstream)) return false;
+    const cv::Mat* input = &cache.entries[Cache::StageCanny].mat;
+
+    // 7./8. Block occupancy + output raster in a single pass over the edge map
+    const int pixelSize = std::max(2, params.pixelSize);
+    cv::Mat& pixelArtMat = cache.entries[Cache::StagePixelate].mat;
+    if (!(upstream = cache.lookup(Cache::StagePixelate, Cache::stageKey(Cache::StagePixelate, params), upstream))) {
+        ProfileScope scope(Cache::stageName(Cache::StagePixelate));
+        cv::Mat pixelArt = cache.buffers.acquire(input->size(), CV_8UC1);
+        pixelateEdges(*input, pixelSize, pixelArt, cache.blockCoords, &cache.blockGrid);
+        scope.setBytes(pixelArt.total() * pixelArt.elemSize() + cache.blockCoords.capacity() * sizeof(sf::Vector2i));
+        pixelArtMat = pixelArt;
+    }
+
+    outPixelArtMat = pixelArtMat;
+    outBlockCoords = cache.blockCoords;
+    return true;
+}
+
+bool processImageProxy(const cv::Mat& proxyMat, cv::Size originalSize, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords, cv::Mat& outBlockMask, ProcessingCache& cache, const std::atomic<bool>* cancel) {
+    using Cache = ProcessingCache;
+    if (proxyMat.empty() || originalSize.width <= 0 || originalSize.height <= 0) { std::cerr << "processImageProxy: empty input." << std::endl; return false; }
+    outBlockCoords.clear();
+
+    // Same stages on the proxy; only the blur kernel is shrunk so it covers the same part of the picture
+    ProcessingParams proxyParams = params;
+    if (params.applyBlur && params.blurKernel > 1) {
+        int kernel = static_cast<int>(std::round(params.blurKernel * static_cast<double>(proxyMat.cols) / originalSize.width));
+        proxyParams.blurKernel = kernel % 2 == 0 ? kernel + 1 : kernel;
+    }
+    bool upstream = false;
+    if (!cache.runImageStages(proxyMat, proxyParams, cancel, upstream)) return false;
+    const cv::Mat& edges = cache.entries[Cache::StageCanny].mat;
+
+    // 7. Map onto the full-resolution block grid: each block covers pixelSize x pixelSize processed pixels, i.e. a
+    // fractional rectangle of the proxy. Padding the proxy to whole blocks and area-averaging it down to one cell per
+    // block lights every block whose rectangle contains (or touches) an edge pixel.
+    const int pixelSize = std::max(2, params.pixelSize);
+    Cache::Entry& entry = cache.entries[Cache::StagePixelate];
+    if (!cache.lookup(Cache::StagePixelate, Cache::stageKey(Cache::StagePixelate, params), upstream)) {
+        ProfileScope scope("Proxy blocks");
+        const cv::Size full = processedSize(originalSize, params.scale);
+        const sf::Vector2i grid = blockGridSize(full, pixelSize);
+        const int paddedW = std::max(edges.cols, static_cast<int>(std::round(static_cast<double>(grid.x) * pixelSize * edges.cols / full.width)));
+        const int paddedH = std::max(edges.rows, static_cast<int>(std::round(static_cast<double>(grid.y) * pixelSize * edges.rows / full.height)));
+        cv::Mat padded, cells, mask;
+        cv::copyMakeBorder(edges, padded, 0, paddedH - edges.rows, 0, paddedW - edges.cols, cv::BORDER_CONSTANT, cv::Scalar(0));
+        padded.convertTo(padded, CV_32F);
+        cv::resize(padded, cells, { grid.x, grid.y }, 0, 0, cv::INTER_AREA);
+        mask = cells > 0.0;
+
+        cache.blockGrid.assignMask(mask);
+        cache.blockCoords.clear();
+        cache.blockGrid.appendCoords(cache.blockCoords); // Row-major, same order as pixelateEdges
+        scope.setBytes(padded.total() * padded.elemSize() + cells.total() * cells.elemSize());
+        entry.mat = mask;
+    }
+
+    outBlockMask = entry.mat;
+    outBlockCoords = cache.blockCoords;
+    return true;
+}
+
+cv::Size processedSize(cv::Size originalSize, float scale) {
+    if (scale == 1.0f) return originalSize;
+    return { static_cast<int>(std::round(originalSize.width * scale)), static_cast<int>(std::round(originalSize.height * scale)) };
+}
+
+bool runPipelineStage(int stage, const cv::Mat& input, cv::Mat& output, const ProcessingParams& params, ProcessingContext* workspace) {
+    using Cache = ProcessingCache;
+    // A destination of the right size and type is written in place by OpenCV instead of being reallocated
+    auto buffer = [workspace](cv::Size size, int type) { return workspace ? workspace->acquire(size, type) : cv::Mat(); };
+    switch (stage) {
+    case Cache::StageScale: {
+        cv::Mat inputMat;
+        if (input.channels() == 4) { inputMat = buffer(input.size(), CV_8UC3); cv::cvtColor(input, inputMat, cv::COLOR_BGRA2BGR); }
+        else { inputMat = input; }
+        if (params.scale != 1.0f) {
+            const cv::Size dsize = processedSize(inputMat.size(), params.scale);
+            int interp = params.scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
+            output = buffer(dsize, inputMat.type());
+            cv::resize(inputMat, output, dsize, 0, 0, interp);
+        }
+        else { output = inputMat; }
+        return true;
+    }
+    case Cache::StageAdjust:
+        if (params.contrast != 1.0f || params.brightness != 0) { output = buffer(input.size(), input.type()); input.convertTo(output, -1, params.contrast, params.brightness); }
+        else { output = input; }
+        return true;
+    case Cache::StageBlur:
+        if (params.applyBlur && params.blurKernel > 1) {
+            output = buffer(input.size(), input.type());
+            cv::GaussianBlur(input, output, { params.blurKernel, params.blurKernel }, 0, 0, cv::BORDER_DEFAULT);
+        }
+        else { output = input; }
+        return true;
+    case Cache::StageFlip: {
+        int flipCode = -2; if (params.flipV && params.flipH) flipCode = -1; else if (params.flipV) flipCode = 0; else if (params.flipH) flipCode = 1;
+        if (flipCode > -2) { output = buffer(input.size(), input.type()); cv::flip(input, output, flipCode); }
+        else { output = input; }
+        return true;
+    }
+    case Cache::StageGray:
+        if (input.channels() == 3) { output = buffer(input.size(), CV_8UC1); cv::cvtColor(input, output, cv::COLOR_BGR2GRAY); }
+        else if (input.channels() == 4) { output = buffer(input.size(), CV_8UC1); cv::cvtColor(input, output, cv::COLOR_BGRA2GRAY); }
+        else if (input.channels() == 1) { output = input; }
+        else { std::cerr << "Unsupported channels for grayscale: " << input.channels() << std::endl; return false; }
+        return true;
+    case Cache::StageCanny:
+        output = buffer(input.size(), CV_8UC1);
+        cv::Canny(input, output, params.cannyLow, params.cannyHigh, 3, false);
+        return true;
+    default:
+        std::cerr << "runPipelineStage: not an image stage: " << stage << std::endl;
+        return false;
+    }
+}
+
+// --- ProcessingCache ---
+const char* ProcessingCache::stageName(int stage) {
+    static const char* names[StageCount] = { "Scale", "Adjust", "Blur", "Flip", "Grayscale", "Canny", "Pixelate" };
+    return (stage >= 0 && stage < StageCount) ? names[stage] : "?";
+}
+
+void ProcessingCache::invalidate() {
+    for (Entry& entry : entries) { entry.valid = false; entry.mat.release(); }
+    source.release();
+    blockCoords.clear();
+    blockGrid.reset(0, 0);
+}
+
+void ProcessingCache::invalidateFrom(int stage) {
+    for (int i = std::max(0, stage); i < StageCount; ++i) { entries[i].valid = false; entries[i].mat.release(); }
+    if (stage <= StagePixelate) { blockCoords.clear(); blockGrid.reset(0, 0); }
+}
+
+bool ProcessingCache::runImageStages(const cv::Mat& originalMat, const ProcessingParams& params, const std::atomic<bool>* cancel, bool& upstream) {
+    // Every stage writes a fresh Mat (or aliases its input when it is a no-op), so cached outputs are never modified in place
+    upstream = source.data == originalMat.data && source.size() == originalMat.size() && source.type() == originalMat.type();
+    source = originalMat;
+
+    // Checked before each stage. Once a stage has been recomputed, the cached stages after it belong to older inputs and must go.
+    auto cancelled = [&](int stage) {
+        if (!cancel || !cancel->load(std::memory_order_relaxed)) return false;
+        if (!upstream) invalidateFrom(stage);
+        return true;
+    };
+
+    const cv::Mat* input = &originalMat;
+    for (int stage = StageScale; stage <= StageCanny; ++stage) {
+        if (stage > StageScale && cancelled(stage)) return false;
+        if (stage == StageAdjust) {
+            // Adjust..Gray run as one fused pass over the Scale output. Each stage keeps its key and counters, but only
+            // the gray image is stored: a change to any of the four re-runs the whole pass.
+            for (int fused = StageAdjust; fused <= StageGray; ++fused) upstream = lookup(fused, stageKey(fused, params), upstream);
+            if (!upstream) {
+                ProfileScope scope("Adjust..Gray (fused)");
+                for (int fused = StageAdjust; fused < StageGray; ++fused) entries[fused].mat.release();
+                cv::Mat output;
+                const size_t allocationsBefore = buffers.allocations();
+                if (!preprocessFused(*input, output, params, &buffers)) { invalidate(); return false; }
+                if (buffers.allocations() != allocationsBefore) scope.setBytes(output.total() * output.elemSize());
+                entries[StageGray].mat = output;
+            }
+            stage = StageGray;
+            input = &entries[StageGray].mat;
+            continue;
+        }
+        Entry& entry = entries[stage];
+        if (!(upstream = lookup(stage, stageKey(stage, params), upstream))) {
+            ProfileScope scope(stageName(stage));
+            cv::Mat output;
+            const size_t allocationsBefore = buffers.allocations();
+            if (!runPipelineStage(stage, *input, output, params, &buffers)) { invalidate(); return false; }
+            // Only fresh allocations count; a recycled workspace buffer costs no new memory
+            if (output.data != input->data && buffers.allocations() != allocationsBefore) scope.setBytes(output.total() * output.elemSize());
+            entry.mat = output;
+        }
+        input = &entry.mat;
+    }
+    return !cancelled(StagePixelate);
+}
+
+void ProcessingCache::resetCounters() {
+    for (Entry& entry : entries) { entry.hits = 0; entry.misses = 0; }
+}
+
+// --- ProcessingContext ---
+// Only the pool holds it: no cache entry, result or caller can still see its pixels. Copies on other threads change the
+// count with CV_XADD, so it is read the same way (an atomic add of 0) rather than as a plain int.
+static bool unreferenced(const cv::Mat& mat) {
+    return mat.u && CV_XADD(&mat.u->refcount, 0) == 1;
+}
+
+cv::Mat ProcessingContext::acquire(cv::Size size, int type) {
+    for (const cv::Mat& mat : buffers) {
+        if (mat.size() == size && mat.type() == type && unreferenced(mat)) { reuseCount++; return mat; }
+    }
+
+    // Nothing fits: first drop idle buffers of other shapes (left over from a previous image size or scale)
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [&](const cv::Mat& mat) {
+        return unreferenced(mat) && (mat.size() != size || mat.type() != type);
+    }), buffers.end());
+
+    cv::Mat mat(size, type);
+    allocationCount++;
+    if (buffers.size() < maxBuffers) buffers.push_back(mat);
+    recount();
+    return mat;
+}
+
+void ProcessingContext::trim() {
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(), unreferenced), buffers.end());
+    recount();
+}
+
+void ProcessingContext::recount() {
+    bytes = 0;
+    for (const cv::Mat& mat : buffers) bytes += mat.total() * mat.elemSize();
+    peak = std::max(peak, bytes);
+}
+
+ProcessingCache::Key ProcessingCache::stageKey(int stage, const ProcessingParams& params) {
+    switch (stage) {
+    case StageScale: return { params.scale, 0.0 };
+    case StageAdjust: return { params.contrast, static_cast<double>(params.brightness) };
+    case StageBlur: return { (params.applyBlur && params.blurKernel > 1) ? static_cast<double>(params.blurKernel) : 0.0, 0.0 };
+    case StageFlip: return { params.flipV ? 1.0 : 0.0, params.flipH ? 1.0 : 0.0 };
+    case StageCanny: return { static_cast<double>(params.cannyLow), static_cast<double>(params.cannyHigh) };
+    case StagePixelate: return { static_cast<double>(std::max(2, params.pixelSize)), 0.0 };
+    default: return { 0.0, 0.0 };
+    }
+}
+
+bool ProcessingCache::lookup(int stage, const Key& key, bool upstreamHit) {
+    Entry& entry = entries[stage];
+    if (upstreamHit && entry.valid && entry.key == key) { entry.hits++; return true; }
+    entry.misses++;
+    entry.valid = true;
+    entry.key = key;
+    return false;
+}
+
+std::string generateCode(const std::vector<sf::Vector2i>& coords, const std::string& format, sf::Vector2i gridSize) {
+    CoordFormat coordFormat;
+    if (!parseCoordFormat(format, coordFormat)) { return "// Unknown format selected"; }
+    std::string output;
+    output.reserve(estimateSerializedSize(coords.size(), coordFormat, gridSize));
+    serializeCoords(coords, coordFormat, [&output](const char* data, size_t size) { output.append(data, size); return true; }, gridSize);
+    return output;
+}
+
+std::string codeFileExtension(const std::string& format) {
+    if (format == "csharp") return "cs";
+    if (format == "js") return "js";
+    if (format == "python") return "py";
+    if (format == "packed") return "packed.bin";
+    if (format == "spans") return "spans.bin";
+    if (format == "bitset") return "bitset.json";
+    return "txt";
+}
+
+bool setProcessingParam(ProcessingParams& params, const std::string& key, const std::string& value) {
+    try {
+        if (key == "scale") params.scale = std::stof(value);
+        else if (key == "pixelSize") params.pixelSize = std::max(2, std::stoi(value));
+        else if (key == "brightness") params.brightness = std::stoi(value);
+        else if (key == "contrast") params.contrast = std::stof(value);
+        else if (key == "applyBlur") params.applyBlur = (value == "1" || value == "true" || value == "on");
+        else if (key == "blurKernel") { params.blurKernel = std::max(1, std::stoi(value)); if (params.blurKernel % 2 == 0) params.blurKernel++; }
+        else if (key == "cannyLow") params.cannyLow = std::stoi(value);
+        else if (key == "cannyHigh") params.cannyHigh = std::stoi(value);
+        else if (key == "flipV") params.flipV = (value == "1" || value == "true" || value == "on");
+        else if (key == "flipH") params.flipH = (value == "1" || value == "true" || value == "on");
+        else return false;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool loadPreset(const std::string& filename, ProcessingParams& params) {
+    std::ifstream file(filename);
+    if (!file) { std::cerr << "Failed to open preset file: " << filename << std::endl; return false; }
+
+    auto trim = [](std::string s) {
+        const char* ws = " \t\r\n";
+        s.erase(0, s.find_first_not_of(ws));
+        s.erase(s.find_last_not_of(ws) + 1);
+        return s;
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << filename << ":" << lineNumber << ": expected 'key = value'" << std::endl; return false;
+        }
+        std::string key = trim(line.substr(0, eq)), value = trim(line.substr(eq + 1));
+        if (!setProcessingParam(params, key, value)) {
+            std::cerr << filename << ":" << lineNumber << ": invalid preset entry '" << key << "'" << std::endl; return false;
+        }
+    }
+    return true;
+}
+
+cv::Mat loadImageBgr(const std::string& filename) {
+    return cv::imread(filename, cv::IMREAD_COLOR | cv::IMREAD_IGNORE_ORIENTATION);
+}
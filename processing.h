@@ -0,0 +1,138 @@
+// Image -> pixelated edge art pipeline shared by the GUI and the batch tool
+
+#pragma once
+
+#include "block_grid.h"
+
+#include <SFML/System/Vector2.hpp>
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Helper struct for processing parameters
+struct ProcessingParams {
+    float scale = 0.5f;
+    int pixelSize = 10;
+    int brightness = 0;
+    float contrast = 1.0f;
+    bool applyBlur = false;
+    int blurKernel = 3;
+    int cannyLow = 50;
+    int cannyHigh = 100;
+    bool flipV = false;
+    bool flipH = false;
+};
+
+class ProcessingCache;
+class ProcessingContext;
+
+// --- Function Prototypes ---
+// Both return false if the image could not be processed or the run was cancelled
+// One-off run: every buffer is allocated for this call. Loops should keep a ProcessingCache and use the overload below.
+bool processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords);
+// Same as above, but reuses the intermediates in 'cache' for every stage whose inputs did not change since the previous call,
+// and recycles the cache's stage buffers (see ProcessingContext) for those that did.
+// If 'cancel' is set it is polled between stages; stages finished before the abort stay cached.
+bool processImage(const cv::Mat& originalMat, cv::Mat& outPixelArtMat, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords, ProcessingCache& cache, const std::atomic<bool>* cancel = nullptr);
+// Serializes the coordinates in any coord_serializer format ("csharp", "js", "python", "packed", "spans", "bitset").
+// Binary formats come back as raw bytes in the string. 'gridSize' is the block grid, {0, 0} derives it from the coordinates.
+std::string generateCode(const std::vector<sf::Vector2i>& coords, const std::string& format, sf::Vector2i gridSize = { 0, 0 });
+
+// Fast approximation of processImage for interactive previews. Runs the image stages on 'proxyMat' (the original
+// downsampled to a fraction of 'originalSize'), then maps the proxy edges onto the block grid a full-resolution run
+// would use, so the blocks line up with the final result. 'outBlockMask' is that grid, one pixel per block (255 = lit).
+bool processImageProxy(const cv::Mat& proxyMat, cv::Size originalSize, const ProcessingParams& params, std::vector<sf::Vector2i>& outBlockCoords, cv::Mat& outBlockMask, ProcessingCache& cache, const std::atomic<bool>* cancel = nullptr);
+// Size of the image the block grid refers to: originalSize after the Scale stage
+cv::Size processedSize(cv::Size originalSize, float scale);
+
+// Runs one image stage of processImage (ProcessingCache::StageScale .. StageCanny). 'output' receives a new Mat (taken
+// from 'workspace' when given), or shares 'input' when the stage is a no-op for these params; 'input' itself is never
+// written. False on unsupported input. processImage runs StageAdjust..StageGray as one pass (preprocessFused); this
+// staged form is the reference it is checked against.
+bool runPipelineStage(int stage, const cv::Mat& input, cv::Mat& output, const ProcessingParams& params, ProcessingContext* workspace = nullptr);
+
+// File extension (without dot) used when writing code of the given format to disk
+std::string codeFileExtension(const std::string& format);
+
+// Sets a single parameter from its preset key ("pixelSize", "cannyLow", ...). Returns false for unknown keys or bad values.
+bool setProcessingParam(ProcessingParams& params, const std::string& key, const std::string& value);
+// Loads a preset file made of "key = value" lines ('#' starts a comment) on top of the given params
+bool loadPreset(const std::string& filename, ProcessingParams& params);
+// Decodes an image file into the 8-bit BGR layout loadImage produces in the GUI. EXIF orientation is ignored, as SFML
+// ignores it, so the headless tools see the same pixels. Empty if the file cannot be decoded.
+cv::Mat loadImageBgr(const std::string& filename);
+
+// Pool of stage buffers reused across processImage calls. acquire() hands out a pooled Mat of the requested size and
+// type that nothing else references any more (cached stage outputs and Mats held by callers stay untouched), so OpenCV
+// writes into it instead of allocating. Not thread-safe: use one per processing thread.
+// The reference count is a buffer's only sign of use: hand Mats to other threads by value (never by reference), so the
+// count covers every thread still reading the pixels, and release them only once done with them.
+class ProcessingContext {
+public:
+    cv::Mat acquire(cv::Size size, int type);
+    // Frees every pooled buffer that is not referenced elsewhere
+    void trim();
+
+    size_t currentBytes() const { return bytes; }
+    size_t peakBytes() const { return peak; }
+    size_t reuses() const { return reuseCount; }
+    size_t allocations() const { return allocationCount; }
+
+    static constexpr size_t maxBuffers = 32;
+
+private:
+    void recount();
+
+    std::vector<cv::Mat> buffers;
+    size_t bytes = 0, peak = 0;
+    size_t reuseCount = 0, allocationCount = 0;
+};
+
+// Keeps the output of every processImage stage, keyed on the ProcessingParams fields that stage reads.
+// A stage is reused only if its own key matches and everything upstream was reused too, so moving
+// "Pixel Size" re-runs just the pixelation and moving the Canny thresholds starts from the cached gray image.
+// The source image is identified by its buffer; call invalidate() if its pixels are modified in place.
+class ProcessingCache {
+public:
+    enum Stage { StageScale, StageAdjust, StageBlur, StageFlip, StageGray, StageCanny, StagePixelate, StageCount };
+    static const char* stageName(int stage);
+
+    void invalidate();
+    void resetCounters();
+    ProcessingContext& workspace() { return buffers; }
+    const ProcessingContext& workspace() const { return buffers; }
+    size_t hits(int stage) const { return entries[stage].hits; }
+    size_t misses(int stage) const { return entries[stage].misses; }
+    // Lit blocks of the last run that got as far as the pixelation stage, same blocks as its coordinates
+    const BlockGrid& blocks() const { return blockGrid; }
+
+private:
+    friend bool processImage(const cv::Mat&, cv::Mat&, const ProcessingParams&, std::vector<sf::Vector2i>&, ProcessingCache&, const std::atomic<bool>*);
+    friend bool processImageProxy(const cv::Mat&, cv::Size, const ProcessingParams&, std::vector<sf::Vector2i>&, cv::Mat&, ProcessingCache&, const std::atomic<bool>*);
+
+    using Key = std::array<double, 2>;
+    struct Entry {
+        bool valid = false;
+        Key key{};
+        cv::Mat mat;
+        size_t hits = 0, misses = 0;
+    };
+    // True if the stage output can be reused. Otherwise counts a miss and re-keys the entry for the caller to refill.
+    bool lookup(int stage, const Key& key, bool upstreamHit);
+    // The ProcessingParams fields 'stage' reads
+    static Key stageKey(int stage, const ProcessingParams& params);
+    // Drops 'stage' and everything after it, used when a run stops before refreshing them
+    void invalidateFrom(int stage);
+    // Brings StageScale..StageCanny up to date for 'originalMat'. 'upstream' tells the caller whether the Canny output
+    // was reused. False if a stage failed or 'cancel' was raised before the pixelation stage.
+    bool runImageStages(const cv::Mat& originalMat, const ProcessingParams& params, const std::atomic<bool>* cancel, bool& upstream);
+
+    std::array<Entry, StageCount> entries;
+    cv::Mat source; // Shallow reference, keeps the buffer (and therefore its address) alive
+    std::vector<sf::Vector2i> blockCoords;
+    BlockGrid blockGrid;
+    ProcessingContext buffers;
+};
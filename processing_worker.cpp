@@ -0,0 +1,180 @@
+#include "processing_worker.h"
+#include "profiler.h"
+#include "block_kernel.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+namespace {
+    // One texel per block, limited to the blocks the raster actually draws so the preview matches the saved output at
+    // the right and bottom edges. A raster too small for any block gets a single black texel.
+    void buildBlockPreview(const cv::Mat& blockMask, cv::Size processed, int pixelSize, cv::Mat& outRgba) {
+        const sf::Vector2i drawn = drawnBlockGridSize(processed, pixelSize);
+        if (drawn.x == 0 || drawn.y == 0) { outRgba = cv::Mat(1, 1, CV_8UC4, cv::Scalar(0, 0, 0, 255)); return; }
+        cv::cvtColor(blockMask(cv::Rect(0, 0, drawn.x, drawn.y)), outRgba, cv::COLOR_GRAY2RGBA);
+    }
+}
+
+ProcessingWorker::ProcessingWorker() {
+    thread = std::thread(&ProcessingWorker::run, this);
+}
+
+ProcessingWorker::~ProcessingWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pendingJob.reset();
+    }
+    cancelRequested = true;
+    wakeCv.notify_all();
+    thread.join();
+}
+
+void ProcessingWorker::setSource(const cv::Mat& originalMat) {
+    std::lock_guard<std::mutex> lock(mutex);
+    source = originalMat;
+    generation++;
+    pendingJob.reset();
+    latestResult.reset();
+    cacheResetPending = true;
+    if (running) cancelRequested = true;
+}
+
+void ProcessingWorker::submit(const ProcessingParams& params, const std::string& codeFormat, int proxyWidth) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingJob = Job{ params, codeFormat, proxyWidth, generation };
+        if (running && std::chrono::steady_clock::now() - lastDelivery < maxStaleness) cancelRequested = true;
+    }
+    wakeCv.notify_one();
+}
+
+void ProcessingWorker::resetCacheCounters() {
+    std::lock_guard<std::mutex> lock(mutex);
+    counterResetPending = true;
+}
+
+std::optional<ProcessingResult> ProcessingWorker::takeResult() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::optional<ProcessingResult> result = std::move(latestResult);
+    latestResult.reset();
+    return result;
+}
+
+bool ProcessingWorker::busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running || pendingJob.has_value();
+}
+
+bool ProcessingWorker::hasResult() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latestResult.has_value();
+}
+
+bool ProcessingWorker::runProxy(const Job& job, const cv::Mat& jobSource, ProcessingResult& result, bool& aborted) {
+    const int pixelSize = std::max(2, job.params.pixelSize);
+    const cv::Size full = processedSize(jobSource.size(), job.params.scale);
+    const int targetWidth = std::max(job.proxyWidth, 2 * blockGridSize(full, pixelSize).x);
+    const int factor = full.width / std::max(1, targetWidth);
+    if (factor < 2) return false;
+
+    if (factor != proxyFactor || proxySource.empty()) {
+        ProfileScope scope("Proxy source");
+        cv::resize(jobSource, proxySource, { std::max(1, jobSource.cols / factor), std::max(1, jobSource.rows / factor) }, 0, 0, cv::INTER_AREA);
+        scope.setBytes(proxySource.total() * proxySource.elemSize());
+        proxyFactor = factor;
+    }
+
+    cv::Mat blockMask;
+    if (!processImageProxy(proxySource, jobSource.size(), job.params, blockCoords, blockMask, proxyCache, &cancelRequested)) {
+        if (cancelRequested) aborted = true;
+        else std::cerr << "ProcessingWorker: proxy processing failed." << std::endl;
+        return true;
+    }
+    {
+        ProfileScope scope("Block preview");
+        buildBlockPreview(blockMask, full, pixelSize, result.previewRgba);
+        scope.setBytes(result.previewRgba.total() * result.previewRgba.elemSize());
+    }
+    result.processedSize = full;
+    result.blockGrid = proxyCache.blocks();
+    result.pixelSize = pixelSize;
+    result.proxyFactor = factor;
+    result.ok = !result.previewRgba.empty();
+    return true;
+}
+
+void ProcessingWorker::run() {
+    Profiler::instance().setThreadName("ProcessingWorker");
+    while (true) {
+        Job job;
+        cv::Mat jobSource;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCv.wait(lock, [this] { return stopping || pendingJob.has_value(); });
+            if (stopping) return;
+            job = std::move(*pendingJob);
+            pendingJob.reset();
+            jobSource = source;
+            if (cacheResetPending) {
+                cache.invalidate(); proxyCache.invalidate(); proxySource.release(); proxyFactor = 0;
+                codeGrid.reset(0, 0); code.clear();
+                cacheResetPending = false;
+            }
+            if (counterResetPending) { cache.resetCounters(); counterResetPending = false; }
+            running = true;
+            cancelRequested = false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        ProcessingResult result;
+        bool aborted = false;
+        // The raster stays on this thread and is dropped before the next job, so the stage cache is its only owner and
+        // its buffer goes back to the workspace pool once the pixelation stage is re-run
+        cv::Mat pixelArtMat;
+        const bool proxied = job.proxyWidth > 0 && runProxy(job, jobSource, result, aborted);
+        if (proxied) { /* Preview only: no raster, no code */ }
+        else if (processImage(jobSource, pixelArtMat, job.params, blockCoords, cache, &cancelRequested)) {
+            result.blockGrid = cache.blocks();
+            {
+                // The UI only needs one texel per block, pixelSize^2 times less to convert and upload than the raster
+                ProfileScope scope("Block preview");
+                result.pixelSize = std::max(2, job.params.pixelSize);
+                result.processedSize = pixelArtMat.size();
+                buildBlockPreview(result.blockGrid.toMask(), result.processedSize, result.pixelSize, result.previewRgba);
+                scope.setBytes(result.previewRgba.total() * result.previewRgba.elemSize());
+            }
+            if (cancelRequested) { aborted = true; }
+            else {
+                // Settings that move no block (e.g. small threshold changes) produce the same text; reuse it
+                if (result.blockGrid != codeGrid || job.codeFormat != codeFormat) {
+                    ProfileScope scope("generateCode");
+                    code = generateCode(blockCoords, job.codeFormat, result.blockGrid.size());
+                    scope.setBytes(code.capacity());
+                    codeGrid = result.blockGrid;
+                    codeFormat = job.codeFormat;
+                }
+                result.code = code;
+                result.ok = !result.previewRgba.empty();
+            }
+        }
+        else if (cancelRequested) { aborted = true; }
+        else { std::cerr << "ProcessingWorker: processing failed." << std::endl; }
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        for (int stage = 0; stage < ProcessingCache::StageCount; ++stage) {
+            result.cacheHits[stage] = cache.hits(stage);
+            result.cacheMisses[stage] = cache.misses(stage);
+        }
+        const ProcessingContext& workspace = cache.workspace();
+        result.workspace = { workspace.currentBytes(), workspace.peakBytes(), workspace.reuses(), workspace.allocations() };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        if (!aborted && job.generation == generation) {
+            latestResult = std::move(result);
+            lastDelivery = std::chrono::steady_clock::now();
+        }
+    }
+}
@@ -0,0 +1,102 @@
+// Background thread that runs processImage off the UI thread
+
+#pragma once
+
+#include "processing.h"
+
+#include <opencv2/core.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WorkspaceStats {
+    size_t bytes = 0, peakBytes = 0;
+    size_t reuses = 0, allocations = 0;
+};
+
+struct ProcessingResult {
+    bool ok = false;
+    cv::Mat previewRgba;                      // One RGBA texel per block the raster draws (drawnBlockGridSize, white = lit),
+                                              // ready for sf::Texture::update
+    cv::Size processedSize;                   // Size of the raster the preview stands for
+    int pixelSize = 2;                        // Block size the preview was built with
+    int proxyFactor = 1;                      // > 1: quick preview from a source downsampled by this factor, no code/raster
+    BlockGrid blockGrid;                      // Lit blocks, 1 bit each; diff against the previous result to update incrementally
+    std::string code;                         // generateCode output in the requested format
+    double milliseconds = 0.0;
+    std::array<size_t, ProcessingCache::StageCount> cacheHits{};
+    std::array<size_t, ProcessingCache::StageCount> cacheMisses{};
+    WorkspaceStats workspace;                 // Stage buffer pool of the full-resolution cache
+};
+
+// Only the newest request is kept: submitting while another one is queued replaces it, and submitting while a job
+// is running aborts that job at its next stage boundary. To keep the preview moving during a long slider drag,
+// a running job is allowed to finish if nothing has been delivered for 'maxStaleness'.
+class ProcessingWorker {
+public:
+    ProcessingWorker();
+    ~ProcessingWorker();
+
+    ProcessingWorker(const ProcessingWorker&) = delete;
+    ProcessingWorker& operator=(const ProcessingWorker&) = delete;
+
+    // Switches to a new image: drops queued work, aborts the running job and clears the stage cache
+    void setSource(const cv::Mat& originalMat);
+    // 'proxyWidth' > 0 asks for a quick preview about that many processed pixels wide (at least two per block),
+    // run on a cached downsampled copy of the source. Falls back to a full run when the image is already that small.
+    void submit(const ProcessingParams& params, const std::string& codeFormat, int proxyWidth = 0);
+    void resetCacheCounters();
+
+    // Non-blocking; returns the newest finished result once
+    std::optional<ProcessingResult> takeResult();
+    bool busy() const;
+    // A finished result is waiting for takeResult()
+    bool hasResult() const;
+
+    std::chrono::milliseconds maxStaleness{ 250 };
+
+private:
+    struct Job {
+        ProcessingParams params;
+        std::string codeFormat;
+        int proxyWidth = 0;
+        unsigned long long generation = 0;
+    };
+
+    void run();
+    // Runs 'job' on the proxy if that is worthwhile; false means the caller should do a full run instead
+    bool runProxy(const Job& job, const cv::Mat& jobSource, ProcessingResult& result, bool& aborted);
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::atomic<bool> cancelRequested{ false };
+
+    // Guarded by mutex
+    cv::Mat source;
+    unsigned long long generation = 0;
+    std::optional<Job> pendingJob;
+    std::optional<ProcessingResult> latestResult;
+    bool running = false;
+    bool stopping = false;
+    bool cacheResetPending = false;
+    bool counterResetPending = false;
+    std::chrono::steady_clock::time_point lastDelivery;
+
+    // Only touched by the worker thread
+    ProcessingCache cache;
+    ProcessingCache proxyCache;
+    cv::Mat proxySource;
+    int proxyFactor = 0;
+    std::vector<sf::Vector2i> blockCoords;    // Scratch for processImage, reused across jobs
+    // Last generated code and the blocks/format it was made from: an unchanged grid skips the serializer
+    BlockGrid codeGrid;
+    std::string codeFormat, code;
+};
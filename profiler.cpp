@@ -0,0 +1,118 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() : epoch(Clock::now()), ring(capacity) {}
+
+unsigned Profiler::currentThreadId() {
+    static std::atomic<unsigned> nextId{ 1 };
+    thread_local const unsigned id = nextId++;
+    return id;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    threadNames[currentThreadId()] = name;
+}
+
+void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end, size_t bytes) {
+    ProfileEvent event;
+    event.name = name;
+    event.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+    event.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    event.bytes = bytes;
+    event.threadId = currentThreadId();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ring[next] = event;
+    next = (next + 1) % capacity;
+    count = std::min(count + 1, capacity);
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    next = 0; count = 0;
+}
+
+std::vector<ProfileEvent> Profiler::events() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ProfileEvent> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) result.push_back(ring[(next + capacity - count + i) % capacity]);
+    return result;
+}
+
+std::vector<ProfileSummary> Profiler::summarize(size_t history) const {
+    const std::vector<ProfileEvent> all = events();
+    std::vector<ProfileSummary> summaries;
+    std::vector<std::vector<const ProfileEvent*>> perName;
+    // Compared by content: the same literal can live at different addresses in different translation units
+    auto sameName = [](const char* a, const char* b) { return a == b || (a && b && std::strcmp(a, b) == 0); };
+    for (const ProfileEvent& event : all) {
+        size_t i = 0;
+        while (i < summaries.size() && !sameName(summaries[i].name, event.name)) ++i;
+        if (i == summaries.size()) { summaries.push_back(ProfileSummary()); summaries.back().name = event.name; perName.emplace_back(); }
+        perName[i].push_back(&event);
+    }
+
+    for (size_t i = 0; i < summaries.size(); ++i) {
+        ProfileSummary& summary = summaries[i];
+        const std::vector<const ProfileEvent*>& list = perName[i];
+        const size_t first = list.size() > history ? list.size() - history : 0;
+        double totalBytes = 0.0;
+        for (size_t j = first; j < list.size(); ++j) {
+            const float ms = static_cast<float>(list[j]->durationNs / 1e6);
+            summary.recentMs.push_back(ms);
+            summary.averageMs += ms;
+            summary.maxMs = std::max(summary.maxMs, static_cast<double>(ms));
+            totalBytes += static_cast<double>(list[j]->bytes);
+        }
+        const size_t n = list.size() - first;
+        if (n > 0) {
+            summary.averageMs /= n;
+            summary.averageBytes = totalBytes / n;
+            summary.lastBytes = list.back()->bytes;
+        }
+    }
+    return summaries;
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename) const {
+    const std::vector<ProfileEvent> all = events();
+    std::map<unsigned, std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        names = threadNames;
+    }
+
+    std::ofstream file(filename);
+    if (!file) { std::cerr << "Failed to open trace file: " << filename << std::endl; return false; }
+
+    // Names are identifiers and thread labels chosen by the code, so they need no JSON escaping
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool firstEntry = true;
+    for (const auto& thread : names) {
+        file << (firstEntry ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+             << ",\"args\":{\"name\":\"" << thread.second << "\"}}";
+        firstEntry = false;
+    }
+    file << std::fixed << std::setprecision(3);
+    for (const ProfileEvent& event : all) {
+        file << (firstEntry ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+             << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0
+             << ",\"args\":{\"bytes\":" << event.bytes << "}}";
+        firstEntry = false;
+    }
+    file << "\n]}\n";
+    if (!file) { std::cerr << "Failed to write trace file: " << filename << std::endl; return false; }
+    return true;
+}
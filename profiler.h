@@ -0,0 +1,91 @@
+// Lightweight scoped timers for the pipeline, kept in a fixed-size ring buffer and exportable as a Chrome trace
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ProfileEvent {
+    const char* name = nullptr;  // Must outlive the profiler (string literals, ProcessingCache::stageName)
+    long long startNs = 0;       // Relative to the profiler's epoch
+    long long durationNs = 0;
+    size_t bytes = 0;            // Bytes the scope allocated for its output, 0 if it reused or aliased a buffer
+    unsigned threadId = 0;
+};
+
+// Rolling view of the most recent events with the same name
+struct ProfileSummary {
+    const char* name = nullptr;
+    std::vector<float> recentMs;   // Oldest first
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+    size_t lastBytes = 0;
+    double averageBytes = 0.0;
+};
+
+// Disabled by default, in which case a ProfileScope costs one relaxed atomic load. Once the ring is full the
+// oldest events are overwritten, so recording never allocates.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t capacity = 8192;
+
+    static Profiler& instance();
+
+    void setEnabled(bool enabled) { isEnabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return isEnabled.load(std::memory_order_relaxed); }
+    // Label for the calling thread in exported traces
+    void setThreadName(const std::string& name);
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end, size_t bytes);
+    void clear();
+
+    // Copy of the ring, oldest first
+    std::vector<ProfileEvent> events() const;
+    // One entry per name in order of first appearance, each holding up to 'history' of its latest events
+    std::vector<ProfileSummary> summarize(size_t history = 64) const;
+    // Chrome trace event format (load in chrome://tracing or https://ui.perfetto.dev)
+    bool writeChromeTrace(const std::string& filename) const;
+
+    static unsigned currentThreadId();
+
+private:
+    Profiler();
+
+    std::atomic<bool> isEnabled{ false };
+    const Clock::time_point epoch;
+
+    mutable std::mutex mutex;
+    std::vector<ProfileEvent> ring;   // Guarded by mutex
+    size_t next = 0;
+    size_t count = 0;
+    std::map<unsigned, std::string> threadNames;
+};
+
+// Records the time between construction and destruction under 'name'
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name(name), active(Profiler::instance().enabled()) {
+        if (active) start = Profiler::Clock::now();
+    }
+    ~ProfileScope() {
+        if (active) Profiler::instance().record(name, start, Profiler::Clock::now(), bytes);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    void setBytes(size_t allocatedBytes) { bytes = allocatedBytes; }
+
+private:
+    const char* name;
+    bool active;
+    Profiler::Clock::time_point start;
+    size_t bytes = 0;
+};
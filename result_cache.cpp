@@ -0,0 +1,299 @@
+#include "result_cache.h"
+#include "block_kernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    // --- Memory-mapped read-only file ---
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() { close(); }
+
+        bool open(const fs::path& path) {
+            close();
+#if defined(_WIN32)
+            // FILE_SHARE_DELETE lets another process evict the entry while it is mapped here
+            file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize)) { close(); return false; }
+            length = static_cast<size_t>(fileSize.QuadPart);
+            if (length == 0) return true;
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) { close(); return false; }
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0) { close(); return false; }
+            length = static_cast<size_t>(info.st_size);
+            if (length == 0) return true;
+            view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) view = nullptr;
+#endif
+            if (!view) { close(); return false; }
+            return true;
+        }
+
+        void close() {
+#if defined(_WIN32)
+            if (view) UnmapViewOfFile(view);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = nullptr; file = INVALID_HANDLE_VALUE;
+#else
+            if (view) munmap(view, length);
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+            view = nullptr; length = 0;
+        }
+
+        const std::uint8_t* data() const { return static_cast<const std::uint8_t*>(view); }
+        size_t size() const { return length; }
+
+    private:
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+        void* view = nullptr;
+        size_t length = 0;
+    };
+
+    // --- XXH64 ---
+    const std::uint64_t prime1 = 0x9E3779B185EBCA87ull, prime2 = 0xC2B2AE3D27D4EB4Full, prime3 = 0x165667B19E3779F9ull;
+    const std::uint64_t prime4 = 0x85EBCA77C2B2AE63ull, prime5 = 0x27D4EB2F165667C5ull;
+
+    inline std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    inline std::uint64_t read64(const std::uint8_t* p) { std::uint64_t v; std::memcpy(&v, p, 8); return v; }
+    inline std::uint32_t read32(const std::uint8_t* p) { std::uint32_t v; std::memcpy(&v, p, 4); return v; }
+    inline std::uint64_t round64(std::uint64_t acc, std::uint64_t input) { return rotl(acc + input * prime2, 31) * prime1; }
+    inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value) { return (acc ^ round64(0, value)) * prime1 + prime4; }
+
+    // --- Entry layout (little-endian) ---
+    // "EPXC", u16 version, u16 reserved, i32 processed width, height, pixel size, grid width, height, u32 words per row,
+    // u64 XXH64 of the words, then the BlockGrid words row by row
+    const char entryMagic[4] = { 'E', 'P', 'X', 'C' };
+    const size_t entryHeaderSize = 40;
+    const char* entryExtension = ".epxc";
+
+    void putLE(std::uint8_t* p, std::uint64_t value, int bytes) { for (int i = 0; i < bytes; ++i) p[i] = static_cast<std::uint8_t>(value >> (8 * i)); }
+    std::uint64_t getLE(const std::uint8_t* p, int bytes) { std::uint64_t value = 0; for (int i = 0; i < bytes; ++i) value |= static_cast<std::uint64_t>(p[i]) << (8 * i); return value; }
+
+    std::string hex64(std::uint64_t value) {
+        std::ostringstream out;
+        out << std::hex << std::setw(16) << std::setfill('0') << value;
+        return out.str();
+    }
+
+    // Unique per process and call, so concurrent writers of the same key never share a temporary file
+    std::string tempSuffix() {
+        static std::atomic<unsigned> counter{ 0 };
+        static const unsigned processSalt = std::random_device{}();
+        std::ostringstream out;
+        out << ".tmp" << std::hex << processSalt << "-" << counter++;
+        return out.str();
+    }
+}
+
+std::uint64_t hashBytes(const void* data, size_t size, std::uint64_t seed) {
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+    const std::uint8_t* const end = p + size;
+    std::uint64_t h;
+    if (size >= 32) {
+        std::uint64_t v1 = seed + prime1 + prime2, v2 = seed + prime2, v3 = seed, v4 = seed - prime1;
+        for (const std::uint8_t* limit = end - 32; p <= limit; p += 32) {
+            v1 = round64(v1, read64(p)); v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16)); v4 = round64(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1); h = mergeRound(h, v2); h = mergeRound(h, v3); h = mergeRound(h, v4);
+    }
+    else { h = seed + prime5; }
+    h += size;
+
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * prime1 + prime4;
+    if (p + 4 <= end) { h = rotl(h ^ (read32(p) * prime1), 23) * prime2 + prime3; p += 4; }
+    for (; p < end; ++p) h = rotl(h ^ (*p * prime5), 11) * prime1;
+
+    h ^= h >> 33; h *= prime2;
+    h ^= h >> 29; h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string canonicalParams(const ProcessingParams& params) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << std::setprecision(9)
+        << "scale=" << params.scale << ";pixelSize=" << std::max(2, params.pixelSize)
+        << ";brightness=" << params.brightness << ";contrast=" << params.contrast
+        << ";blur=" << (params.applyBlur && params.blurKernel > 1 ? params.blurKernel : 0)
+        << ";canny=" << params.cannyLow << "," << params.cannyHigh
+        << ";flip=" << params.flipV << params.flipH;
+    return out.str();
+}
+
+ResultCache::ResultCache(const std::string& directory, std::uint64_t maxBytes) : maxBytes(maxBytes) {
+    if (directory.empty()) return;
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (!fs::is_directory(directory, ec)) { std::cerr << "ResultCache: cannot use directory " << directory << ", caching disabled." << std::endl; return; }
+    dir = directory;
+    evict();
+}
+
+std::string ResultCache::entryPath(const std::string& key) const {
+    return (fs::path(dir) / (key + entryExtension)).string();
+}
+
+bool ResultCache::makeKey(const std::string& sourcePath, const ProcessingParams& params, std::string& outKey) const {
+    MappedFile source;
+    if (!source.open(sourcePath)) return false;
+    const std::uint64_t contentHash = hashBytes(source.data(), source.size());
+    const std::string paramsText = canonicalParams(params);
+    outKey = hex64(contentHash) + "-" + hex64(hashBytes(paramsText.data(), paramsText.size(), formatVersion));
+    return true;
+}
+
+bool ResultCache::load(const std::string& key, CachedResult& outResult) {
+    if (!enabled()) { missCount++; return false; }
+    const std::string path = entryPath(key);
+    {
+        MappedFile entry;
+        if (!entry.open(path) || entry.size() < entryHeaderSize) { missCount++; return false; }
+        const std::uint8_t* p = entry.data();
+        const int width = static_cast<std::int32_t>(getLE(p + 8, 4)), height = static_cast<std::int32_t>(getLE(p + 12, 4));
+        const int pixelSize = static_cast<std::int32_t>(getLE(p + 16, 4));
+        const int gridW = static_cast<std::int32_t>(getLE(p + 20, 4)), gridH = static_cast<std::int32_t>(getLE(p + 24, 4));
+        const std::uint64_t words = getLE(p + 28, 4) * static_cast<std::uint64_t>(std::max(0, gridH));
+        const bool valid = std::memcmp(p, entryMagic, 4) == 0 && getLE(p + 4, 2) == static_cast<std::uint64_t>(formatVersion)
+            && width > 0 && height > 0 && pixelSize >= 2 && sf::Vector2i(gridW, gridH) == blockGridSize({ width, height }, pixelSize)
+            && getLE(p + 28, 4) == static_cast<std::uint64_t>((gridW + 63) / 64) && entry.size() == entryHeaderSize + words * 8
+            && getLE(p + 32, 8) == hashBytes(p + entryHeaderSize, words * 8);
+        if (!valid) { std::cerr << "ResultCache: ignoring damaged entry " << path << std::endl; missCount++; return false; }
+
+        outResult.processedSize = { width, height };
+        outResult.pixelSize = pixelSize;
+        outResult.blockGrid.assignWords(gridW, gridH, p + entryHeaderSize);
+    }
+    // Recently used entries survive eviction
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    hitCount++;
+    return true;
+}
+
+bool ResultCache::store(const std::string& key, const CachedResult& result) {
+    if (!enabled()) return false;
+    const BlockGrid& grid = result.blockGrid;
+    const size_t wordBytes = static_cast<size_t>(grid.wordsPerRow()) * grid.height() * sizeof(std::uint64_t);
+    const std::uint8_t* words = grid.height() > 0 ? reinterpret_cast<const std::uint8_t*>(grid.rowWords(0)) : nullptr;
+
+    std::uint8_t header[entryHeaderSize] = {};
+    std::memcpy(header, entryMagic, 4);
+    putLE(header + 4, formatVersion, 2);
+    putLE(header + 8, static_cast<std::uint32_t>(result.processedSize.width), 4);
+    putLE(header + 12, static_cast<std::uint32_t>(result.processedSize.height), 4);
+    putLE(header + 16, static_cast<std::uint32_t>(result.pixelSize), 4);
+    putLE(header + 20, static_cast<std::uint32_t>(grid.width()), 4);
+    putLE(header + 24, static_cast<std::uint32_t>(grid.height()), 4);
+    putLE(header + 28, static_cast<std::uint32_t>(grid.wordsPerRow()), 4);
+    putLE(header + 32, hashBytes(words, wordBytes), 8);
+
+    // Readers only ever see complete entries: write aside, then rename into place
+    const std::string path = entryPath(key);
+    const std::string tempPath = path + tempSuffix();
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        if (wordBytes) file.write(reinterpret_cast<const char*>(words), wordBytes);
+        file.close();
+        if (!file) {
+            std::cerr << "ResultCache: failed to write " << tempPath << std::endl;
+            std::error_code ec; fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        // Another process may hold the same entry open; it has the same content, so keeping theirs is fine
+        fs::remove(tempPath, ec);
+        return false;
+    }
+
+    if ((approxBytes += sizeof(header) + wordBytes) > maxBytes) evict();
+    return true;
+}
+
+void ResultCache::evict() {
+    std::lock_guard<std::mutex> lock(evictMutex);
+    struct Entry { fs::path path; std::uint64_t size; fs::file_time_type lastUse; };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    std::error_code ec;
+    const auto now = fs::file_time_type::clock::now();
+    for (const fs::directory_entry& item : fs::directory_iterator(dir, ec)) {
+        std::error_code itemEc;
+        if (!item.is_regular_file(itemEc)) continue;
+        const fs::path& path = item.path();
+        const fs::file_time_type lastUse = item.last_write_time(itemEc);
+        if (itemEc) continue;
+        // Leftovers of writers that crashed between write and rename
+        if (path.filename().string().find(".tmp") != std::string::npos) {
+            if (now - lastUse > std::chrono::hours(1)) fs::remove(path, itemEc);
+            continue;
+        }
+        if (path.extension() != entryExtension) continue;
+        const std::uint64_t size = item.file_size(itemEc);
+        if (itemEc) continue;
+        entries.push_back({ path, size, lastUse });
+        total += size;
+    }
+
+    if (total > maxBytes) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        const std::uint64_t target = maxBytes / 10 * 9;
+        for (const Entry& entry : entries) {
+            if (total <= target) break;
+            // Fails harmlessly if another process evicted it first (or, on Windows, still has it mapped)
+            if (fs::remove(entry.path, ec)) { total -= entry.size; evictionCount++; }
+        }
+    }
+    approxBytes = total;
+}
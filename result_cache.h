@@ -0,0 +1,63 @@
+// Content-addressed on-disk cache of processing results, shared between runs and processes
+
+#pragma once
+
+#include "processing.h"
+#include "block_grid.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// What a cache entry holds: the block grid plus what it takes to rebuild the raster (pixelArtFromGrid) and the preview
+struct CachedResult {
+    cv::Size processedSize;  // Size of the edge map / pixel-art raster
+    int pixelSize = 2;
+    BlockGrid blockGrid;
+};
+
+// Entries live in one directory as "<file hash>-<params hash>.epxc", so the same image under another name or path
+// still hits. Entries are written to a temporary file and renamed into place, and read through a read-only memory
+// mapping, so any number of processes can share the directory. A hit refreshes the entry's modification time; once
+// the directory grows past 'maxBytes' the least recently used entries are deleted.
+class ResultCache {
+public:
+    // Bump whenever processImage output changes for the same params, so older entries stop matching
+    static constexpr int formatVersion = 1;
+
+    // Creates 'directory' if needed. An empty directory disables the cache (every lookup misses, nothing is stored).
+    explicit ResultCache(const std::string& directory, std::uint64_t maxBytes = 256ull << 20);
+
+    bool enabled() const { return !dir.empty(); }
+    // Key for the file at 'sourcePath' processed with 'params'. Hashes the raw file bytes; nothing is decoded.
+    // False if the file cannot be read.
+    bool makeKey(const std::string& sourcePath, const ProcessingParams& params, std::string& outKey) const;
+    // Counts a hit or a miss. Corrupt or truncated entries count as misses.
+    bool load(const std::string& key, CachedResult& outResult);
+    bool store(const std::string& key, const CachedResult& result);
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    size_t evictions() const { return evictionCount; }
+    double hitRate() const { const size_t total = hitCount + missCount; return total ? static_cast<double>(hitCount) / total : 0.0; }
+
+private:
+    std::string entryPath(const std::string& key) const;
+    // Deletes least recently used entries until the directory is back under 90% of maxBytes
+    void evict();
+
+    std::string dir;
+    std::uint64_t maxBytes;
+    std::atomic<std::uint64_t> approxBytes{ 0 }; // This process' view of the directory size, refreshed by every evict()
+    std::atomic<size_t> hitCount{ 0 }, missCount{ 0 }, evictionCount{ 0 };
+    std::mutex evictMutex;
+};
+
+// ProcessingParams fields in a fixed text form, with settings that cannot change the output normalised away
+// (e.g. the blur kernel while blur is off)
+std::string canonicalParams(const ProcessingParams& params);
+// XXH64 of 'size' bytes
+std::uint64_t hashBytes(const void* data, size_t size, std::uint64_t seed = 0);
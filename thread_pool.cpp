@@ -0,0 +1,99 @@
+#include "thread_pool.h"
+
+#include <iostream>
+#include <exception>
+#include <algorithm>
+
+namespace {
+    // Set once by each worker thread; the index only means something to the pool that owns the thread
+    thread_local const ThreadPool* tlsPool = nullptr;
+    thread_local int tlsWorkerIndex = -1;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wakeCv.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+int ThreadPool::currentWorkerIndex() const {
+    return tlsPool == this ? tlsWorkerIndex : -1;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    const int worker = currentWorkerIndex();
+    unsigned target = worker >= 0 ? static_cast<unsigned>(worker) : nextQueue.fetch_add(1) % size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        ++queuedTasks; ++pendingTasks;
+    }
+    wakeCv.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    doneCv.wait(lock, [this] { return pendingTasks == 0; });
+}
+
+bool ThreadPool::popTask(unsigned index, std::function<void()>& outTask) {
+    // Own queue first (LIFO keeps the working set warm)...
+    {
+        WorkerQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            outTask = std::move(own.tasks.back()); own.tasks.pop_back();
+            return true;
+        }
+    }
+    // ...then steal the oldest task from the others
+    for (unsigned offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            outTask = std::move(victim.tasks.front()); victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    tlsPool = this;
+    tlsWorkerIndex = static_cast<int>(index);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait(lock, [this] { return stopping || queuedTasks > 0; });
+            if (queuedTasks == 0) return; // Stopping and nothing left to do
+            --queuedTasks; // Claim one task; it is guaranteed to be in some queue
+        }
+
+        std::function<void()> task;
+        while (!popTask(index, task)) { std::this_thread::yield(); }
+
+        try { task(); }
+        catch (const std::exception& e) { std::cerr << "ThreadPool: task threw: " << e.what() << std::endl; }
+        catch (...) { std::cerr << "ThreadPool: task threw an unknown exception" << std::endl; }
+
+        bool allDone;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            allDone = (--pendingTasks == 0);
+        }
+        if (allDone) doneCv.notify_all();
+    }
+}
@@ -0,0 +1,51 @@
+// Small work-stealing thread pool used by the batch tool
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every worker owns a deque: it pops its own work from the back and steals from the front of the others' deques when idle.
+// Tasks submitted from outside the pool are spread round-robin, tasks submitted from a worker go to that worker's deque.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount = 0); // 0 = std::thread::hardware_concurrency()
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until every submitted task has finished
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+    // Index of the calling thread among this pool's workers, or -1 for any other thread (including another pool's workers)
+    int currentWorkerIndex() const;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    bool popTask(unsigned index, std::function<void()>& outTask);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{ 0 };
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+    long long queuedTasks = 0;  // Guarded by wakeMutex
+    long long pendingTasks = 0; // Submitted but not finished, guarded by wakeMutex
+    bool stopping = false;
+};
@@ -0,0 +1,399 @@
+#include "tiled_processing.h"
+#include "block_kernel.h"
+#include "preprocess_kernel.h"
+#include "thread_pool.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cfloat>
+#include <cctype>
+#include <algorithm>
+
+namespace {
+    // --- Tile sources ---
+    // Hands out BGR pixels of the original image by rectangle. read() may be called from several threads at once.
+    class TileSource {
+    public:
+        virtual ~TileSource() = default;
+        virtual cv::Size size() const = 0;
+        virtual bool read(const cv::Rect& rect, cv::Mat& outBgr) = 0;
+        virtual bool streamed() const = 0;
+    };
+
+    // Fallback for compressed formats: decode once, hand out ROIs
+    class DecodedSource : public TileSource {
+    public:
+        explicit DecodedSource(cv::Mat decoded) : image(std::move(decoded)) {}
+        cv::Size size() const override { return image.size(); }
+        bool read(const cv::Rect& rect, cv::Mat& outBgr) override { outBgr = image(rect); return true; }
+        bool streamed() const override { return false; }
+
+    private:
+        cv::Mat image;
+    };
+
+    // Uncompressed rows on disk (binary 8-bit PPM, BI_RGB 24/32-bit BMP): only the requested rows are read
+    class RawFileSource : public TileSource {
+    public:
+        static std::unique_ptr<RawFileSource> open(const std::string& filename);
+
+        cv::Size size() const override { return imageSize; }
+        bool streamed() const override { return true; }
+
+        bool read(const cv::Rect& rect, cv::Mat& outBgr) override {
+            cv::Mat raw(rect.height, rect.width, CV_8UC(bytesPerPixel));
+            const std::streamsize rowBytes = static_cast<std::streamsize>(rect.width) * bytesPerPixel;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int r = 0; r < rect.height; ++r) {
+                    const int y = rect.y + r;
+                    const long long fileRow = bottomUp ? imageSize.height - 1 - y : y;
+                    file.seekg(dataOffset + fileRow * static_cast<long long>(stride) + static_cast<long long>(rect.x) * bytesPerPixel);
+                    file.read(reinterpret_cast<char*>(raw.ptr(r)), rowBytes);
+                    if (file.gcount() != rowBytes) { file.clear(); return false; }
+                }
+            }
+            if (bytesPerPixel == 4) { cv::cvtColor(raw, outBgr, cv::COLOR_BGRA2BGR); }
+            else if (rgbOrder) { cv::cvtColor(raw, outBgr, cv::COLOR_RGB2BGR); }
+            else { outBgr = raw; }
+            return true;
+        }
+
+    private:
+        std::ifstream file;
+        std::mutex mutex;
+        cv::Size imageSize;
+        long long dataOffset = 0;
+        size_t stride = 0;
+        int bytesPerPixel = 3;
+        bool bottomUp = false;
+        bool rgbOrder = false;
+    };
+
+    std::uint32_t readLE(const unsigned char* p, int bytes) {
+        std::uint32_t value = 0;
+        for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | p[i];
+        return value;
+    }
+
+    std::unique_ptr<RawFileSource> RawFileSource::open(const std::string& filename) {
+        auto source = std::make_unique<RawFileSource>();
+        source->file.open(filename, std::ios::binary);
+        if (!source->file) return nullptr;
+
+        char magic[2] = { 0, 0 };
+        source->file.read(magic, 2);
+        if (magic[0] == 'P' && magic[1] == '6') {
+            // Header: "P6" <ws> width <ws> height <ws> maxval <single ws> data, '#' comments allowed between fields
+            int fields[3] = { 0, 0, 0 };
+            for (int& field : fields) {
+                int c = source->file.get();
+                while (c == '#' || std::isspace(c)) {
+                    if (c == '#') { while (c != '\n' && c != EOF) c = source->file.get(); }
+                    c = source->file.get();
+                }
+                if (!std::isdigit(c)) return nullptr;
+                while (std::isdigit(c)) { field = field * 10 + (c - '0'); c = source->file.get(); }
+                if (c == EOF) return nullptr;
+            }
+            if (fields[0] <= 0 || fields[1] <= 0 || fields[2] != 255) return nullptr;
+            source->imageSize = cv::Size(fields[0], fields[1]);
+            source->dataOffset = static_cast<long long>(source->file.tellg());
+            source->bytesPerPixel = 3;
+            source->stride = static_cast<size_t>(fields[0]) * 3;
+            source->rgbOrder = true;
+            return source;
+        }
+        if (magic[0] == 'B' && magic[1] == 'M') {
+            unsigned char header[54];
+            source->file.seekg(0);
+            source->file.read(reinterpret_cast<char*>(header), sizeof(header));
+            if (source->file.gcount() != static_cast<std::streamsize>(sizeof(header))) return nullptr;
+            const std::uint32_t dataOffset = readLE(header + 10, 4);
+            const int width = static_cast<std::int32_t>(readLE(header + 18, 4));
+            const int height = static_cast<std::int32_t>(readLE(header + 22, 4));
+            const int bitCount = static_cast<int>(readLE(header + 28, 2));
+            const std::uint32_t compression = readLE(header + 30, 4);
+            if (compression != 0 || (bitCount != 24 && bitCount != 32) || width <= 0 || height == 0) return nullptr;
+            source->imageSize = cv::Size(width, std::abs(height));
+            source->dataOffset = dataOffset;
+            source->bytesPerPixel = bitCount / 8;
+            source->stride = ((static_cast<size_t>(width) * bitCount + 31) / 32) * 4;
+            source->bottomUp = height > 0;
+            return source;
+        }
+        return nullptr;
+    }
+
+    // --- Tile geometry ---
+    enum class Resample { None, AreaFast, Area, Linear };
+
+    // Source taps of the destination pixels along one axis, computed for the whole image as cv::resize does, so a tile
+    // resampled from them gets the same pixels as the full-image run
+    struct AreaTap { int src; float alpha; };
+    struct LinearTap { int src0, src1; short w0, w1; };
+
+    struct Axis {
+        std::vector<AreaTap> area;      // Resample::Area, grouped by destination pixel
+        std::vector<int> areaFirst;     // Index of each destination pixel's first tap in 'area', plus the end
+        std::vector<LinearTap> linear;  // Resample::Linear, one per destination pixel
+    };
+
+    struct Geometry {
+        cv::Size sourceSize;
+        int width = 0, height = 0;      // Processed (scaled) size
+        Resample resample = Resample::None;
+        int areaX = 1, areaY = 1;       // Source pixels per processed pixel for Resample::AreaFast
+        Axis x, y;                      // Taps for Resample::Area and Resample::Linear
+        int halo = 0;
+    };
+
+    // INTER_LINEAR weights are 11-bit fixed point for 8-bit images
+    const int linearWeightScale = 1 << 11;
+
+    // computeResizeAreaTab of OpenCV's resize.cpp: a destination pixel covers 'scale' source pixels, the partly covered
+    // ones at either end weighted by their share
+    void areaTaps(int ssize, int dsize, Axis& axis) {
+        const double scale = 1.0 / (static_cast<double>(dsize) / ssize);
+        axis.areaFirst.assign(1, 0);
+        for (int d = 0; d < dsize; ++d) {
+            const double fs1 = d * scale, fs2 = fs1 + scale;
+            const double cellWidth = std::min(scale, ssize - fs1);
+            const int s2 = std::min(cvFloor(fs2), ssize - 1), s1 = std::min(cvCeil(fs1), s2);
+            if (s1 - fs1 > 1e-3) axis.area.push_back({ s1 - 1, static_cast<float>((s1 - fs1) / cellWidth) });
+            for (int s = s1; s < s2; ++s) axis.area.push_back({ s, static_cast<float>(1.0 / cellWidth) });
+            if (fs2 - s2 > 1e-3) axis.area.push_back({ s2, static_cast<float>(std::min(std::min(fs2 - s2, 1.0), cellWidth) / cellWidth) });
+            axis.areaFirst.push_back(static_cast<int>(axis.area.size()));
+        }
+    }
+
+    // cv::resize's INTER_LINEAR mapping, (d + 0.5) * scale - 0.5 in float. Columns past the edge take the edge pixel at
+    // full weight ('clampWeights'); rows keep their weights and read the edge row twice.
+    void linearTaps(int ssize, int dsize, bool clampWeights, Axis& axis) {
+        const double scale = 1.0 / (static_cast<double>(dsize) / ssize);
+        axis.linear.resize(dsize);
+        for (int d = 0; d < dsize; ++d) {
+            float f = static_cast<float>((d + 0.5) * scale - 0.5);
+            int s = cvFloor(f);
+            f -= s;
+            if (clampWeights && s < 0) { f = 0.f; s = 0; }
+            if (clampWeights && s >= ssize - 1) { f = 0.f; s = ssize - 1; }
+            axis.linear[d] = { std::clamp(s, 0, ssize - 1), std::clamp(s + 1, 0, ssize - 1),
+                               cv::saturate_cast<short>((1.f - f) * linearWeightScale), cv::saturate_cast<short>(f * linearWeightScale) };
+        }
+    }
+
+    // INTER_AREA for a fractional ratio, restricted to 'region'. The crop reaches one pixel past the region's whole cells
+    // where a source pixel straddles the border, and every sum adds the same terms in the same order as cv::resize.
+    bool areaRegion(TileSource& source, const Geometry& g, const cv::Rect& region, cv::Mat& outMat) {
+        const std::vector<AreaTap>& xTaps = g.x.area;
+        const std::vector<AreaTap>& yTaps = g.y.area;
+        const int xBegin = g.x.areaFirst[region.x], xEnd = g.x.areaFirst[region.x + region.width];
+        const int yBegin = g.y.areaFirst[region.y], yEnd = g.y.areaFirst[region.y + region.height];
+        const cv::Rect crop(xTaps[xBegin].src, yTaps[yBegin].src, xTaps[xEnd - 1].src - xTaps[xBegin].src + 1, yTaps[yEnd - 1].src - yTaps[yBegin].src + 1);
+        cv::Mat pixels;
+        if (!source.read(crop, pixels)) return false;
+
+        const int cn = pixels.channels(), rowLength = region.width * cn;
+        std::vector<float> buf(rowLength), sum(rowLength);
+        outMat.create(region.size(), pixels.type());
+        for (int dy = 0; dy < region.height; ++dy) {
+            const int jBegin = g.y.areaFirst[region.y + dy], jEnd = g.y.areaFirst[region.y + dy + 1];
+            for (int j = jBegin; j < jEnd; ++j) {
+                // Horizontal: one row of cell sums
+                const std::uint8_t* row = pixels.ptr<std::uint8_t>(yTaps[j].src - crop.y);
+                std::fill(buf.begin(), buf.end(), 0.f);
+                for (int dx = 0; dx < region.width; ++dx) {
+                    float* cell = &buf[dx * cn];
+                    for (int k = g.x.areaFirst[region.x + dx]; k < g.x.areaFirst[region.x + dx + 1]; ++k) {
+                        const std::uint8_t* p = row + (xTaps[k].src - crop.x) * cn;
+                        for (int c = 0; c < cn; ++c) cell[c] = cell[c] + p[c] * xTaps[k].alpha;
+                    }
+                }
+                // Vertical: weighted sum of those rows
+                const float beta = yTaps[j].alpha;
+                if (j == jBegin) { for (int i = 0; i < rowLength; ++i) sum[i] = beta * buf[i]; }
+                else { for (int i = 0; i < rowLength; ++i) sum[i] += beta * buf[i]; }
+            }
+            std::uint8_t* out = outMat.ptr<std::uint8_t>(dy);
+            for (int i = 0; i < rowLength; ++i) out[i] = cv::saturate_cast<std::uint8_t>(sum[i]);
+        }
+        return true;
+    }
+
+    // INTER_LINEAR, restricted to 'region', in cv::resize's 8-bit fixed point. The vertical pass rounds like OpenCV's
+    // vectorized one (each product truncated to its high 16 bits), which it uses for the whole row.
+    bool linearRegion(TileSource& source, const Geometry& g, const cv::Rect& region, cv::Mat& outMat) {
+        const LinearTap* xTaps = &g.x.linear[region.x];
+        const LinearTap* yTaps = &g.y.linear[region.y];
+        const cv::Rect crop(xTaps[0].src0, yTaps[0].src0, xTaps[region.width - 1].src1 - xTaps[0].src0 + 1, yTaps[region.height - 1].src1 - yTaps[0].src0 + 1);
+        cv::Mat pixels;
+        if (!source.read(crop, pixels)) return false;
+
+        // Horizontal: every source row of the crop, scaled by linearWeightScale
+        const int cn = pixels.channels(), rowLength = region.width * cn;
+        cv::Mat rows(crop.height, rowLength, CV_32SC1);
+        for (int r = 0; r < crop.height; ++r) {
+            const std::uint8_t* src = pixels.ptr<std::uint8_t>(r);
+            int* dst = rows.ptr<int>(r);
+            for (int dx = 0; dx < region.width; ++dx) {
+                const std::uint8_t* p0 = src + (xTaps[dx].src0 - crop.x) * cn;
+                const std::uint8_t* p1 = src + (xTaps[dx].src1 - crop.x) * cn;
+                for (int c = 0; c < cn; ++c) dst[dx * cn + c] = p0[c] * xTaps[dx].w0 + p1[c] * xTaps[dx].w1;
+            }
+        }
+
+        // Vertical
+        outMat.create(region.size(), pixels.type());
+        for (int dy = 0; dy < region.height; ++dy) {
+            const int* h0 = rows.ptr<int>(yTaps[dy].src0 - crop.y);
+            const int* h1 = rows.ptr<int>(yTaps[dy].src1 - crop.y);
+            const int b0 = yTaps[dy].w0, b1 = yTaps[dy].w1;
+            std::uint8_t* out = outMat.ptr<std::uint8_t>(dy);
+            for (int i = 0; i < rowLength; ++i) {
+                out[i] = cv::saturate_cast<std::uint8_t>((((b0 * (h0[i] >> 4)) >> 16) + ((b1 * (h1[i] >> 4)) >> 16) + 2) >> 2);
+            }
+        }
+        return true;
+    }
+
+    // Scaled pixels of 'region' (processed coordinates, before flipping)
+    bool scaledRegion(TileSource& source, const Geometry& g, const cv::Rect& region, cv::Mat& outMat) {
+        switch (g.resample) {
+        case Resample::None:
+            return source.read(region, outMat);
+        case Resample::AreaFast: {
+            // Block averages depend on their own block only, so resizing the crop is the full-image resize
+            cv::Mat crop;
+            if (!source.read({ region.x * g.areaX, region.y * g.areaY, region.width * g.areaX, region.height * g.areaY }, crop)) return false;
+            cv::resize(crop, outMat, region.size(), 0, 0, cv::INTER_AREA);
+            return true;
+        }
+        case Resample::Area:
+            return areaRegion(source, g, region, outMat);
+        default:
+            return linearRegion(source, g, region, outMat);
+        }
+    }
+
+    // One output tile (processed + flipped coordinates) -> its lit blocks in global block coordinates
+    bool processTile(TileSource& source, const ProcessingParams& params, const Geometry& g, const cv::Rect& tile, std::vector<sf::Vector2i>& outCoords) {
+        // 1. Where the tile comes from before the flip, plus halo
+        int x0 = params.flipH ? g.width - (tile.x + tile.width) : tile.x;
+        int y0 = params.flipV ? g.height - (tile.y + tile.height) : tile.y;
+        const int ex0 = std::max(0, x0 - g.halo), ex1 = std::min(g.width, x0 + tile.width + g.halo);
+        const int ey0 = std::max(0, y0 - g.halo), ey1 = std::min(g.height, y0 + tile.height + g.halo);
+        const cv::Rect region(ex0, ey0, ex1 - ex0, ey1 - ey0);
+
+        // 2. Scale
+        cv::Mat scaled;
+        if (!scaledRegion(source, g, region, scaled)) return false;
+
+        // 3. Adjust, flip the region locally, grayscale and blur in the same fused pass as processImage.
+        // The result covers [flippedX, flippedX + width) of the processed image.
+        cv::Mat grayMat, edgeMat;
+        if (!preprocessFused(scaled, grayMat, params)) return false;
+        const int flippedX = params.flipH ? g.width - ex1 : ex0;
+        const int flippedY = params.flipV ? g.height - ey1 : ey0;
+
+        // 4. Canny on the haloed region, then drop the halo
+        cv::Canny(grayMat, edgeMat, params.cannyLow, params.cannyHigh, 3, false);
+        cv::Mat tileEdges = edgeMat({ tile.x - flippedX, tile.y - flippedY, tile.width, tile.height });
+
+        // 5. Blocks (tiles start on block boundaries)
+        const int pixelSize = std::max(2, params.pixelSize);
+        cv::Mat tileArt;
+        pixelateEdges(tileEdges, pixelSize, tileArt, outCoords);
+        for (sf::Vector2i& coord : outCoords) { coord.x += tile.x / pixelSize; coord.y += tile.y / pixelSize; }
+        return true;
+    }
+}
+
+bool processImageTiled(const std::string& filename, const ProcessingParams& params, const TiledOptions& options, TiledResult& outResult) {
+    outResult = TiledResult();
+
+    std::unique_ptr<TileSource> source = RawFileSource::open(filename);
+    if (!source) {
+        cv::Mat decoded = loadImageBgr(filename);
+        if (decoded.empty()) { std::cerr << "Failed to load image: " << filename << std::endl; return false; }
+        source = std::make_unique<DecodedSource>(std::move(decoded));
+    }
+    outResult.streamed = source->streamed();
+
+    // Same sizing as step 1 of processImage
+    Geometry g;
+    g.sourceSize = source->size();
+    const cv::Size processed = processedSize(g.sourceSize, params.scale);
+    g.width = processed.width; g.height = processed.height;
+    if (g.width <= 0 || g.height <= 0) { std::cerr << "processImageTiled: empty image after scaling: " << filename << std::endl; return false; }
+    if (params.scale < 1.0f) {
+        // INTER_AREA, as cv::resize picks it: block averages when both ratios are whole numbers, cell weights otherwise
+        const double ratioX = 1.0 / (static_cast<double>(g.width) / g.sourceSize.width);
+        const double ratioY = 1.0 / (static_cast<double>(g.height) / g.sourceSize.height);
+        g.areaX = cv::saturate_cast<int>(ratioX); g.areaY = cv::saturate_cast<int>(ratioY);
+        if (std::abs(ratioX - g.areaX) < DBL_EPSILON && std::abs(ratioY - g.areaY) < DBL_EPSILON) { g.resample = Resample::AreaFast; }
+        else {
+            g.resample = Resample::Area;
+            areaTaps(g.sourceSize.width, g.width, g.x);
+            areaTaps(g.sourceSize.height, g.height, g.y);
+        }
+    }
+    else if (params.scale > 1.0f) {
+        g.resample = Resample::Linear;
+        linearTaps(g.sourceSize.width, g.width, true, g.x);
+        linearTaps(g.sourceSize.height, g.height, false, g.y);
+    }
+    g.halo = std::max(0, options.cannyHalo) + ((params.applyBlur && params.blurKernel > 1) ? params.blurKernel / 2 : 0);
+    outResult.processedSize = cv::Size(g.width, g.height);
+
+    const int pixelSize = std::max(2, params.pixelSize);
+    const int tileSize = std::max(pixelSize, options.tileSize - options.tileSize % pixelSize);
+    std::vector<cv::Rect> tiles;
+    for (int y = 0; y < g.height; y += tileSize) {
+        for (int x = 0; x < g.width; x += tileSize) {
+            tiles.push_back({ x, y, std::min(tileSize, g.width - x), std::min(tileSize, g.height - y) });
+        }
+    }
+    outResult.tileCount = tiles.size();
+
+    std::vector<std::vector<sf::Vector2i>> tileCoords(tiles.size());
+    std::atomic<bool> failed{ false };
+    {
+        // Tiles are the parallelism: keep OpenCV's own pool out of the way, then hand it back as it was
+        const int openCvThreads = cv::getNumThreads();
+        ThreadPool pool(options.threads);
+        if (pool.size() > 1) cv::setNumThreads(1);
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            pool.submit([&, i] {
+                if (failed) return;
+                if (!processTile(*source, params, g, tiles[i], tileCoords[i])) failed = true;
+            });
+        }
+        pool.wait();
+        cv::setNumThreads(openCvThreads);
+    }
+    if (failed) { std::cerr << "processImageTiled: failed to read tile data from " << filename << std::endl; return false; }
+
+    // Merge into processImage's raster order
+    size_t total = 0;
+    for (const auto& coords : tileCoords) total += coords.size();
+    outResult.blockCoords.reserve(total);
+    for (auto& coords : tileCoords) {
+        outResult.blockCoords.insert(outResult.blockCoords.end(), coords.begin(), coords.end());
+        std::vector<sf::Vector2i>().swap(coords);
+    }
+    std::sort(outResult.blockCoords.begin(), outResult.blockCoords.end(), [](const sf::Vector2i& a, const sf::Vector2i& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+
+    outResult.blockMask = blockMaskFromCoords(outResult.blockCoords, { g.width, g.height }, pixelSize);
+    return true;
+}
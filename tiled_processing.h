@@ -0,0 +1,34 @@
+// Tiled, bounded-memory execution of the pipeline for very large inputs
+
+#pragma once
+
+#include "processing.h"
+
+#include <opencv2/core.hpp>
+
+#include <string>
+#include <vector>
+
+struct TiledOptions {
+    int tileSize = 1024;    // Tile edge in processed (scaled) pixels, rounded down to a multiple of pixelSize
+    int cannyHalo = 32;     // Context kept around each tile so Canny's hysteresis can follow edges across seams
+    unsigned threads = 0;   // Tiles processed in parallel, 0 = hardware threads
+};
+
+struct TiledResult {
+    cv::Size processedSize;                 // Size of the scaled image the block grid refers to
+    std::vector<sf::Vector2i> blockCoords;  // Same raster order as processImage
+    cv::Mat blockMask;                      // CV_8UC1, one pixel per block, 255 = lit
+    bool streamed = false;                  // Rows were read straight from the file instead of decoding it whole
+    size_t tileCount = 0;
+};
+
+// Processes the image in pixelSize-aligned tiles, each extended by a halo covering the blur kernel and the Canny
+// neighbourhood, so every tile sees the same pixels it would in a full-image run. Binary PPM and uncompressed
+// BMP files are read row range by row range, other formats are decoded once with loadImageBgr. Peak memory is then
+// roughly tile area x threads (plus the decoded source when it can't be streamed).
+//
+// Each tile is resampled from the whole-image taps of cv::resize (INTER_AREA down, INTER_LINEAR up) with its rounding,
+// so it gets the same pixels as processImage at any scale. Only edge chains that leave and re-enter a tile further
+// than cannyHalo away can differ at seams.
+bool processImageTiled(const std::string& filename, const ProcessingParams& params, const TiledOptions& options, TiledResult& outResult);
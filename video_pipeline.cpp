@@ -0,0 +1,215 @@
+#include "video_pipeline.h"
+#include "bounded_queue.h"
+#include "block_kernel.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct DecodedFrame {
+        long long index = 0;
+        cv::Mat frame;
+    };
+
+    struct ProcessedFrame {
+        long long index = 0;
+        bool ok = false;
+        cv::Mat bgrMat;   // Pixel art expanded to 3 channels for cv::VideoWriter
+        std::string code;
+    };
+
+    // Busy time of one stage, summed over all of its threads
+    struct StageStats {
+        std::mutex mutex;
+        long long frames = 0;
+        double busySeconds = 0.0;
+
+        void add(long long frameCount, double seconds) {
+            std::lock_guard<std::mutex> lock(mutex);
+            frames += frameCount; busySeconds += seconds;
+        }
+    };
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::string extensionForFourcc(const std::string& fourcc) {
+        if (fourcc == "mp4v" || fourcc == "avc1" || fourcc == "H264") return ".mp4";
+        return ".avi";
+    }
+
+    // "frames/img_%04d.png" -> "img_04d"
+    std::string baseName(const std::string& input) {
+        std::string stem = fs::path(input).stem().string();
+        stem.erase(std::remove(stem.begin(), stem.end(), '%'), stem.end());
+        return stem.empty() ? "video" : stem;
+    }
+
+    void printStage(const char* name, const StageStats& stats, unsigned threads) {
+        const double perThread = stats.busySeconds > 0.0 ? stats.frames / stats.busySeconds : 0.0;
+        std::cout << "  " << name << ": " << stats.frames << " frames, "
+                  << (stats.frames > 0 ? 1000.0 * stats.busySeconds / stats.frames : 0.0) << " ms/frame, "
+                  << perThread * threads << " fps on " << threads << " thread(s)" << std::endl;
+    }
+}
+
+bool runVideoPipeline(const VideoJob& job) {
+    cv::VideoCapture capture(job.input);
+    if (!capture.isOpened()) { std::cerr << "Failed to open video or frame sequence: " << job.input << std::endl; return false; }
+
+    std::error_code ec;
+    fs::create_directories(job.outputDir, ec);
+    if (ec) { std::cerr << "Failed to create output directory " << job.outputDir << ": " << ec.message() << std::endl; return false; }
+
+    const std::string name = baseName(job.input);
+    const std::string videoPath = !job.outputVideo.empty() ? job.outputVideo : (fs::path(job.outputDir) / (name + "_pixels" + extensionForFourcc(job.fourcc))).string();
+    const fs::path coordsDir = fs::path(job.outputDir) / (name + "_coords");
+    if (job.writeCoords) {
+        fs::create_directories(coordsDir, ec);
+        if (ec) { std::cerr << "Failed to create " << coordsDir.string() << ": " << ec.message() << std::endl; return false; }
+    }
+
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0.0)) fps = 24.0;
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned workerCount = job.workers > 0 ? job.workers : std::max(1u, hardwareThreads > 2 ? hardwareThreads - 2 : 1u);
+    const size_t queueDepth = std::max<size_t>(1, job.queueDepth);
+    const long long window = static_cast<long long>(queueDepth + workerCount);
+    const int openCvThreads = cv::getNumThreads();
+    if (workerCount > 1) cv::setNumThreads(1);
+
+    BoundedQueue<DecodedFrame> decodedQueue(queueDepth);
+    BoundedQueue<ProcessedFrame> processedQueue(static_cast<size_t>(window));
+    StageStats decodeStats, processStats, writeStats;
+    std::atomic<bool> failed{ false };
+
+    // The writer publishes how far it got; the decoder waits on it so the reorder buffer can't grow past 'window'
+    std::mutex windowMutex;
+    std::condition_variable windowCv;
+    long long nextToWrite = 0;
+
+    std::cout << "Streaming " << job.input << " (" << fps << " fps) with " << workerCount << " process worker(s), queue depth " << queueDepth << "..." << std::endl;
+    const auto pipelineStart = Clock::now();
+
+    // 1. Decode
+    std::thread decoder([&] {
+        for (long long index = 0; !failed; ++index) {
+            {
+                std::unique_lock<std::mutex> lock(windowMutex);
+                windowCv.wait(lock, [&] { return failed || index - nextToWrite < window; });
+            }
+            if (failed) break;
+            const auto start = Clock::now();
+            DecodedFrame item{ index, cv::Mat() };
+            if (!capture.read(item.frame) || item.frame.empty()) break;
+            decodeStats.add(1, secondsSince(start));
+            if (!decodedQueue.push(std::move(item))) break;
+        }
+        decodedQueue.close();
+    });
+
+    // 2. Process
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back([&] {
+            DecodedFrame item;
+            std::vector<sf::Vector2i> blockCoords;
+            ProcessingCache cache; // Every frame is a new source; the cache is kept for its stage buffers
+            while (decodedQueue.pop(item)) {
+                const auto start = Clock::now();
+                ProcessedFrame result;
+                result.index = item.index;
+                cv::Mat pixelArtMat;
+                cache.invalidate();
+                result.ok = processImage(item.frame, pixelArtMat, job.params, blockCoords, cache);
+                if (result.ok) {
+                    cv::cvtColor(pixelArtMat, result.bgrMat, cv::COLOR_GRAY2BGR);
+                    if (job.writeCoords) result.code = generateCode(blockCoords, job.format, blockGridSize(pixelArtMat.size(), job.params.pixelSize));
+                }
+                processStats.add(1, secondsSince(start));
+                if (!processedQueue.push(std::move(result))) break;
+            }
+        });
+    }
+
+    // 3. Encode/write, strictly in frame order
+    std::thread writer([&] {
+        cv::VideoWriter videoWriter;
+        std::map<long long, ProcessedFrame> pending;
+        ProcessedFrame item;
+        while (processedQueue.pop(item)) {
+            pending.emplace(item.index, std::move(item));
+            for (auto it = pending.find(nextToWrite); it != pending.end(); it = pending.find(nextToWrite)) {
+                const auto start = Clock::now();
+                ProcessedFrame& frame = it->second;
+                if (!frame.ok) { std::cerr << "Processing failed for frame " << frame.index << std::endl; failed = true; }
+                else {
+                    if (!videoWriter.isOpened()) {
+                        const std::string& f = job.fourcc;
+                        const int fourcc = f.size() == 4 ? cv::VideoWriter::fourcc(f[0], f[1], f[2], f[3]) : cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+                        if (!videoWriter.open(videoPath, fourcc, fps, frame.bgrMat.size(), true)) {
+                            std::cerr << "Failed to open video writer: " << videoPath << std::endl; failed = true;
+                        }
+                    }
+                    if (videoWriter.isOpened()) videoWriter.write(frame.bgrMat);
+                    if (job.writeCoords) {
+                        char fileName[64];
+                        std::snprintf(fileName, sizeof(fileName), "frame_%06lld.", frame.index);
+                        std::ofstream codeFile(coordsDir / (fileName + codeFileExtension(job.format)), std::ios::binary);
+                        codeFile << frame.code;
+                        if (!codeFile) { std::cerr << "Failed to write coordinates for frame " << frame.index << std::endl; failed = true; }
+                    }
+                }
+                pending.erase(it);
+                writeStats.add(1, secondsSince(start));
+                {
+                    std::lock_guard<std::mutex> lock(windowMutex);
+                    nextToWrite++;
+                }
+                windowCv.notify_all();
+                if (failed) break;
+            }
+            if (failed) {
+                // Unblock the other stages so they can wind down
+                windowCv.notify_all();
+                decodedQueue.close();
+                processedQueue.close();
+                break;
+            }
+        }
+        videoWriter.release();
+    });
+
+    decoder.join();
+    for (std::thread& worker : workers) worker.join();
+    processedQueue.close();
+    writer.join();
+    cv::setNumThreads(openCvThreads);
+
+    const double totalSeconds = secondsSince(pipelineStart);
+    std::cout << (failed ? "Stopped after " : "Wrote ") << writeStats.frames << " frame(s) to " << videoPath << " in " << totalSeconds << " s ("
+              << (totalSeconds > 0.0 ? writeStats.frames / totalSeconds : 0.0) << " fps overall)" << std::endl;
+    printStage("decode ", decodeStats, 1);
+    printStage("process", processStats, workerCount);
+    printStage("write  ", writeStats, 1);
+    return !failed;
+}
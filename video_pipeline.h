@@ -0,0 +1,24 @@
+// Streaming mode: video file or numbered frame sequence -> pixel-art video + per-frame coordinates
+
+#pragma once
+
+#include "processing.h"
+
+#include <string>
+
+struct VideoJob {
+    std::string input;          // Anything cv::VideoCapture opens: "clip.mp4", "frames/img_%04d.png", ...
+    std::string outputDir = "out";
+    std::string outputVideo;    // Default: <outputDir>/<input stem>_pixels.<ext for fourcc>
+    ProcessingParams params;
+    std::string format = "csharp";
+    std::string fourcc = "mp4v";
+    unsigned workers = 0;       // Process stage threads, 0 = hardware threads - 2 (decode and encode get one each)
+    size_t queueDepth = 8;      // Frames buffered between stages
+    bool writeCoords = true;
+};
+
+// Runs decode -> N process workers -> ordered encode/write as a bounded three-stage pipeline.
+// The decoder never runs more than queueDepth + workers frames ahead of the writer, so memory stays
+// proportional to that window rather than to the clip length. Prints per-stage throughput at the end.
+bool runVideoPipeline(const VideoJob& job);